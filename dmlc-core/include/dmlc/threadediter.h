@@ -12,6 +12,7 @@
 #include "./base.h"
 // this code depends on c++11
 #if DMLC_ENABLE_STD_THREAD
+#include <atomic>
 #include <condition_variable>
 #include <functional>
 #include <mutex>
@@ -203,13 +204,13 @@ class ThreadedIter : public DataIter<DType> {
   /*! \brief producer class */
   Producer *producer_owned_;
   /*! \brief signal to producer */
-  Signal producer_sig_;
+  std::atomic<Signal> producer_sig_;
   /*! \brief whether the special signal other than kProduce is procssed */
   bool producer_sig_processed_;
   /*! \brief thread that runs the producer */
   std::thread *producer_thread_;
   /*! \brief whether produce ends */
-  bool produce_end_;
+  std::atomic<bool> produce_end_;
   /*! \brief maximum queue size */
   size_t max_capacity_;
   /*! \brief internal mutex */
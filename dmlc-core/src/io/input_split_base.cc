@@ -165,6 +165,7 @@ void InputSplitBase::InitInputFileInfo(const std::string& uri) {
 }
 
 size_t InputSplitBase::Read(void *ptr, size_t size) {
+  const bool is_text_parser = this->IsTextParser();
   if (offset_begin_ >= offset_end_) return 0;
   if (offset_curr_ +  size > offset_end_) {
     size = offset_end_ - offset_curr_;
@@ -178,6 +179,12 @@ size_t InputSplitBase::Read(void *ptr, size_t size) {
     offset_curr_ += n;
     if (nleft == 0) break;
     if (n == 0) {
+      if (is_text_parser) {
+        // Insert a newline between files to handle files with NOEOL.
+        // Otherwise the last line of a file and the first line of the next
+        // file will be merged.
+        buf[0] = '\n'; ++buf; --nleft;
+      }
       if (offset_curr_ != file_offset_[file_ptr_ + 1]) {
         LOG(ERROR) << "curr=" << offset_curr_
                    << ",begin=" << offset_begin_
@@ -87,6 +87,11 @@ class InputSplitBase : public InputSplit {
    *    false if the chunk is already finishes its life
    */
   virtual bool ExtractNextRecord(Blob *out_rec, Chunk *chunk) = 0;
+  /*!
+   * \brief query whether this object is a text parser
+   * \return true if this object represents a text parser; false otherwise
+   */
+  virtual bool IsTextParser(void) { return false; }
 
  protected:
   // constructor
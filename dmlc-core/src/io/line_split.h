@@ -28,6 +28,7 @@ class LineSplitter : public InputSplitBase {
   }
 
   virtual bool ExtractNextRecord(Blob *out_rec, Chunk *chunk);
+  virtual bool IsTextParser(void) { return true; }
  protected:
   virtual size_t SeekRecordBegin(Stream *fi);
   virtual const char*
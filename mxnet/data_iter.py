@@ -1,6 +1,7 @@
 #!/usr/bin/env python
 # -*- coding: utf-8 -*-
 
+import glob
 import sys
 import numpy as np
 from collections import defaultdict
@@ -50,3 +51,24 @@ def read_data(input_file):
     return np.array(XData), np.array(YData)
 
 
+def read_examples(prefix):
+    """Maps the .npy shards written by example_exporter in place:
+    <prefix>-features-*.npy holds int32 [examples, features] and
+    <prefix>-labels-*.npy int32 [examples]. A single shard is returned
+    as is, without reading it; several shards are concatenated.
+    """
+    feature_files = sorted(glob.glob(prefix + '-features-*.npy'))
+    if not feature_files:
+        raise IOError('no examples at %s' % prefix)
+    XData = []
+    YData = []
+    for feature_file in feature_files:
+        XData.append(np.load(feature_file, mmap_mode='r'))
+        YData.append(np.load(feature_file.replace('-features-', '-labels-'),
+                             mmap_mode='r'))
+    if len(XData) == 1:
+        XData, YData = XData[0], YData[0]
+    else:
+        XData, YData = np.concatenate(XData), np.concatenate(YData)
+    print >> logs, 'read %d records from %d shards' % (len(XData), len(feature_files))
+    return XData, YData
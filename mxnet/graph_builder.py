@@ -1,6 +1,7 @@
 #!/usr/bin/env python
 # -*- coding: utf-8 -*-
 
+import os
 import sys
 logs= sys.stderr
 
@@ -87,7 +88,7 @@ class GreedyParser(object):
             last_layer = mx.sym.FullyConnected(data=last_layer,
                     weight= i2h_weight,
                     bias = i2h_bias,
-                    num_hidden=last_layer_size)
+                    num_hidden=hidden_layer_size)
             last_layer = mx.sym.Activation(data=last_layer, act_type='relu')
             last_layer_size = hidden_layer_size
 
@@ -231,7 +232,11 @@ def main():
     embedding_sizes = [64, 32, 32]
     hidden_layer_sizes = [200, 200]
     batch_size = 32
-    xdata, ydata = data_iter.read_data(sys.argv[1])
+    # A text dump of the feature ids, or the prefix of example_exporter's shards.
+    if os.path.isfile(sys.argv[1]):
+        xdata, ydata = data_iter.read_data(sys.argv[1])
+    else:
+        xdata, ydata = data_iter.read_examples(sys.argv[1])
     parser = GreedyParser(num_actions, num_features, num_feature_ids, embedding_sizes, hidden_layer_sizes)
     parser.SetupModel(mx.gpu(0), batch_size=batch_size)
     parser.TrainModel(xdata, ydata)
@@ -3,6 +3,7 @@
 
 #include <fstream>
 #include <algorithm>
+#include <limits>
 #include "../dmlc-core/include/dmlc/logging.h"
 
 using namespace std;
@@ -50,7 +50,7 @@ struct BatchStateOptions {
   // Corpus name to read from context inputs.
   string corpus_name;
 
-  // Whether we allow weights in SparseFeatures protos.
+  // Whether we allow weights in FeatureIds.
   bool allow_feature_weights;
 
   // Whether beams should be considered alive until all states are final,
@@ -155,12 +155,14 @@ public:
                 << (item.first.second < 0 ? "golden" : "");
       }
       if (!transition_system_->IsFinalState(*item.second->state)) {
-        // Not a final state.
+        // Not a final state. The transition system checks each action type
+        // once and broadcasts the result across the labels.
+        allowed_.resize(num_actions);
+        transition_system_->GetAllowedActions(*item.second->state, num_actions,
+                                              allowed_.data());
         for (int action = 0; action < num_actions; ++action) {
           // Is action allowed?
-          if (!transition_system_->IsAllowedAction(action, *item.second->state)) {
-            continue;
-          }
+          if (!allowed_[action]) continue;
           CHECK_LT(slot, score_rows);
           MaybeInsertWithNewAction(item, slot, scores(slot, action), action);
           PruneBeam();
@@ -175,9 +177,9 @@ public:
     UpdateAllFinal();
   }
 
-  void PopulateFeatureOutputs(vector<vector<vector<SparseFeatures>>> *features) {
+  void PopulateFeatureOutputs(vector<vector<FeatureIds>> *features) {
     for (const AgendaItem &item : slots_) {
-      vector<vector<SparseFeatures> > f =
+      vector<FeatureIds> f =
         features_->ExtractSparseFeatures(*workspace_, *item.second->state);
       for (size_t i = 0; i < f.size(); ++i) (*features)[i].push_back(f[i]);
     }
@@ -295,6 +297,9 @@ private:
   int gold_action_ = -1;
   State state_ = ALIVE;
   bool all_final_ = false;
+
+  // Scratch buffer for the allowed actions of a state.
+  vector<uint8_t> allowed_;
 };
 
 // Encapsulates the state of a batch of beams. It is an object of this
@@ -388,7 +393,7 @@ public:
 
   tensorflow::Status PopulateFeatureOutputs(OpKernelContext *context) {
     const int feature_size = FeatureSize();
-    vector<vector<vector<SparseFeatures> > > features(feature_size);
+    vector<vector<FeatureIds> > features(feature_size);
     for (int beam_id = 0; beam_id < BatchSize(); ++beam_id) {
       if (!beams_[beam_id].IsDead()) {
         beams_[beam_id].PopulateFeatureOutputs(&features);
@@ -0,0 +1,145 @@
+#include "benchmark.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <fstream>
+#include <new>
+
+namespace {
+
+std::atomic<int64_t> allocation_count(0);
+
+}  // namespace
+
+// Counting replacements of the global allocation functions. Only the plain
+// forms need replacing; the nothrow and array forms are required by the
+// standard to call them.
+void *operator new(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    void *p = malloc(size == 0 ? 1 : size);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+namespace benchmark {
+
+int64_t AllocationCount() {
+    return allocation_count.load(std::memory_order_relaxed);
+}
+
+void DoNotOptimize(int64_t value) {
+    static volatile int64_t sink;
+    sink = value;
+}
+
+namespace {
+
+// Escapes a string for a JSON string literal.
+string JsonString(const string &text) {
+    string output = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            output.push_back('\\');
+            output.push_back(c);
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buffer[8];
+            snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            output.append(buffer);
+        } else {
+            output.push_back(c);
+        }
+    }
+    output.push_back('"');
+    return output;
+}
+
+// Throughput of a result in megabytes (10^6 bytes) per second.
+double MegabytesPerSecond(const Result &result) {
+    return result.bytes_per_item / result.ns_per_item * 1e3;
+}
+
+}  // namespace
+
+Reporter::Reporter(const string &suite) : suite_(suite) {
+#ifndef NDEBUG
+    LOG(WARNING) << "Benchmarks built without NDEBUG include debug checks; "
+                 << "configure with -DCMAKE_BUILD_TYPE=Release.";
+#endif
+}
+
+void Reporter::Add(const Result &result) {
+    string labels;
+    for (const auto &label : result.labels) {
+        labels += " " + label.first + "=" + label.second;
+    }
+    printf("%-36s%-36s %12.1f ns/%s %10.2f allocs/%s", result.name.c_str(),
+           labels.c_str(), result.ns_per_item, result.unit.c_str(),
+           result.allocations_per_item, result.unit.c_str());
+    if (result.bytes_per_item > 0) printf(" %10.1f MB/s", MegabytesPerSecond(result));
+    printf("\n");
+    fflush(stdout);
+    results_.push_back(result);
+}
+
+bool Reporter::WriteJson(const string &path) const {
+    std::ofstream out(path);
+    out << "{\"suite\": " << JsonString(suite_) << ", \"results\": [";
+    for (size_t i = 0; i < results_.size(); ++i) {
+        const Result &result = results_[i];
+        out << (i > 0 ? ",\n  " : "\n  ")
+            << "{\"name\": " << JsonString(result.name);
+        for (const auto &label : result.labels) {
+            out << ", " << JsonString(label.first) << ": "
+                << JsonString(label.second);
+        }
+        out << ", \"unit\": " << JsonString(result.unit)
+            << ", \"items\": " << result.items
+            << ", \"ns_per_item\": " << result.ns_per_item
+            << ", \"allocations_per_item\": " << result.allocations_per_item;
+        if (result.bytes_per_item > 0) {
+            out << ", \"mb_per_s\": " << MegabytesPerSecond(result);
+        }
+        out << "}";
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
+
+Flags::Flags(int argc, char **argv) {
+    for (int i = 1; i < argc; ++i) {
+        const string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0) {
+            positional_.push_back(arg);
+            continue;
+        }
+        const size_t eq = arg.find('=');
+        if (eq == string::npos) {
+            flags_[arg.substr(2)] = "true";
+        } else {
+            flags_[arg.substr(2, eq - 2)] = arg.substr(eq + 1);
+        }
+    }
+}
+
+string Flags::Get(const string &name, const string &defval) const {
+    auto it = flags_.find(name);
+    return it == flags_.end() ? defval : it->second;
+}
+
+int Flags::Get(const string &name, int defval) const {
+    auto it = flags_.find(name);
+    return it == flags_.end() ? defval : atoi(it->second.c_str());
+}
+
+double Flags::Get(const string &name, double defval) const {
+    auto it = flags_.find(name);
+    return it == flags_.end() ? defval : atof(it->second.c_str());
+}
+
+}  // namespace benchmark
@@ -0,0 +1,134 @@
+/*!
+ * \brief Minimal microbenchmark harness shared by the benchmark binaries.
+ *
+ * A benchmark body processes a fixed number of items (parser states,
+ * lookups, bytes, ...) per call and is repeated until a minimum time has
+ * elapsed. Time and heap allocations are reported per item; allocations are
+ * counted by the global operator new replacement in benchmark.cc, so every
+ * binary linking this harness counts allocations.
+ */
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../utils/utils.h"
+
+namespace benchmark {
+
+// Number of calls to operator new since program start.
+int64_t AllocationCount();
+
+// Prevents the compiler from optimizing away a computed value.
+void DoNotOptimize(int64_t value);
+
+// Result of one benchmark run.
+struct Result {
+    // Name of the measured stage, e.g. "ExtractSparseFeatures".
+    string name;
+
+    // Additional key/value labels, e.g. {"length", "25"}.
+    vector<pair<string, string>> labels;
+
+    // What an item is, e.g. "state".
+    string unit;
+
+    // Total number of items processed.
+    int64_t items = 0;
+
+    double ns_per_item = 0.0;
+
+    double allocations_per_item = 0.0;
+
+    // Input bytes per item; if set, the throughput is reported in MB/s.
+    double bytes_per_item = 0.0;
+};
+
+/*!
+ * \brief Calls body() repeatedly until at least min_time_ms have passed and
+ * returns the time and allocations per item, where each call processes
+ * items_per_call items. One untimed call warms up caches and buffers.
+ */
+template<class F>
+Result Run(const string &name, const string &unit, int64_t items_per_call,
+           double min_time_ms, F body) {
+    typedef std::chrono::steady_clock Clock;
+    body();
+
+    Result result;
+    result.name = name;
+    result.unit = unit;
+    const int64_t allocations = AllocationCount();
+    const Clock::time_point start = Clock::now();
+    double elapsed_ns = 0.0;
+    int64_t calls = 0;
+    while (elapsed_ns < min_time_ms * 1e6) {
+        body();
+        ++calls;
+        elapsed_ns = std::chrono::duration<double, std::nano>(
+            Clock::now() - start).count();
+    }
+    result.items = calls * items_per_call;
+    result.ns_per_item = elapsed_ns / result.items;
+    result.allocations_per_item =
+        static_cast<double>(AllocationCount() - allocations) / result.items;
+    return result;
+}
+
+/*!
+ * \brief Collects results, prints them as a table and optionally writes them
+ * as JSON for regression tracking:
+ *
+ *   {"suite": "...", "results": [{"name": "...", "<label>": "...",
+ *     "unit": "state", "items": 1000, "ns_per_item": 12.5,
+ *     "allocations_per_item": 0, "mb_per_s": 80.0}, ...]}
+ *
+ * where mb_per_s is only present for results with bytes_per_item.
+ */
+class Reporter {
+public:
+    // Warns if the timings would include debug checks.
+    explicit Reporter(const string &suite);
+
+    // Adds a result and prints it.
+    void Add(const Result &result);
+
+    // Writes all results to a JSON file. Returns false on I/O errors.
+    bool WriteJson(const string &path) const;
+
+private:
+    // Name of the benchmark suite.
+    string suite_;
+
+    vector<Result> results_;
+};
+
+/*!
+ * \brief Command line flags of the form --name=value. Arguments that do not
+ * start with "--" are kept as positional arguments.
+ */
+class Flags {
+public:
+    Flags(int argc, char **argv);
+
+    string Get(const string &name, const string &defval) const;
+
+    int Get(const string &name, int defval) const;
+
+    double Get(const string &name, double defval) const;
+
+    const vector<string> &positional() const { return positional_; }
+
+private:
+    map<string, string> flags_;
+
+    vector<string> positional_;
+};
+
+}  // namespace benchmark
+
+#endif
@@ -0,0 +1,347 @@
+/*!
+ * \brief Microbenchmarks for the feature extraction hot path.
+ *
+ * Builds ParserStates over synthetic sentences of controlled lengths and
+ * stack/tree shapes, then times each stage separately:
+ *
+ *  - ParserState::LeftmostChild/RightmostChild/LeftSibling/RightSibling on
+ *    the top two stack tokens and their outermost children,
+ *  - single-feature extractors that differ only in the locator chain
+ *    (input, stack, child, sibling; all end in a "label" lookup, so the
+ *    differences between them are the locator costs),
+ *  - FeatureExtractor::ExtractFeatures for all feature groups of the spec,
+ *  - ConvertExample on the resulting FeatureVectors,
+ *  - ExtractSparseFeatures (both of the above) and ExtractFeatureIds, which
+ *    uses the compiled extractor if the build has one for the spec.
+ *
+ * The shape sets how often the random arc-standard walk that produces the
+ * states reduces instead of shifts: "stack" keeps deep stacks with few arcs,
+ * "balanced" mixes both and "tree" builds most of the tree early.
+ *
+ * Usage (from the directory holding word-map, tag-map and label-map):
+ *
+ *   feature_benchmark [--resource_dir=.] [--spec=src/parser_features.fml]
+ *                     [--lengths=10,25,50] [--states=256] [--min_time_ms=200]
+ *                     [--json=results.json]
+ */
+#include <fstream>
+#include <memory>
+#include <random>
+#include <sstream>
+
+#include "benchmark.h"
+#include "../feature/embedding_feature_extractor.h"
+#include "../lexicon/term_frequency_map.h"
+#include "../parser/parser_state.h"
+#include "../sentence.h"
+#include "../utils/shared_store.h"
+#include "../utils/task_context.h"
+#include "../utils/work_space.h"
+
+namespace {
+
+// Exposes ConvertExample() to the benchmark.
+class BenchmarkFeatureExtractor : public ParserEmbeddingFeatureExtractor {
+public:
+    BenchmarkFeatureExtractor() : ParserEmbeddingFeatureExtractor("parser") {}
+
+    using GenericEmbeddingFeatureExtractor::ConvertExample;
+};
+
+// Shape of the partial trees in the benchmark states.
+struct Shape {
+    const char *name;
+
+    // Probability of reducing when both shifting and reducing are possible.
+    double reduce_probability;
+};
+
+const Shape kShapes[] = {
+    {"stack", 0.2},
+    {"balanced", 0.5},
+    {"tree", 0.8},
+};
+
+// Single-feature specs measuring the locators.
+const pair<const char *, const char *> kLocatorSpecs[] = {
+    {"locator.input", "input(1).label"},
+    {"locator.stack", "stack(1).label"},
+    {"locator.child", "stack.child(1).label"},
+    {"locator.sibling", "stack.child(1).sibling(-1).label"},
+};
+
+// Creates a sentence with words and tags drawn from the term maps, with a few
+// unknown words mixed in.
+Sentence *RandomSentence(int length, const TermFrequencyMap &words,
+                         const TermFrequencyMap &tags, std::mt19937 *rng) {
+    Sentence *sentence = new Sentence();
+    for (int i = 0; i < length; ++i) {
+        Token *token = sentence->add_token();
+        if ((*rng)() % 20 == 0 || words.Size() == 0) {
+            token->set_word("<unknown-" + utils::Printf(i) + ">");
+        } else {
+            token->set_word(words.GetTerm((*rng)() % words.Size()));
+        }
+        if (tags.Size() > 0) token->set_tag(tags.GetTerm((*rng)() % tags.Size()));
+    }
+    return sentence;
+}
+
+// Applies up to num_steps random arc-standard transitions to the state.
+void RandomWalk(int num_steps, double reduce_probability, int num_labels,
+                std::mt19937 *rng, ParserState *state) {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    for (int step = 0; step < num_steps; ++step) {
+        const bool can_shift = !state->EndOfInput();
+        const bool can_reduce = state->StackSize() >= 2;
+        if (!can_shift && !can_reduce) break;
+        if (can_shift && (!can_reduce || uniform(*rng) >= reduce_probability)) {
+            state->Push(state->Next());
+            state->Advance();
+            continue;
+        }
+        const int s0 = state->Pop();
+        const int s1 = state->Pop();
+        const int label = num_labels > 0 ? (*rng)() % num_labels : 0;
+        if ((*rng)() % 2 == 0) {
+            // LEFT_ARC: s1 <- s0.
+            state->AddArc(s1, s0, label);
+            state->Push(s0);
+        } else {
+            // RIGHT_ARC: s1 -> s0.
+            state->AddArc(s0, s1, label);
+            state->Push(s1);
+        }
+    }
+}
+
+// Reads a whole file into a string.
+string ReadFile(const string &path) {
+    std::ifstream file(path);
+    CHECK(file) << "Cannot read " << path;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+// Adds an input with a single file to the task context.
+void AddInput(const string &name, const string &file, TaskContext *context) {
+    TaskInput *input = context->mutable_spec()->add_input();
+    input->set_name(name);
+    input->add_part()->set_file_pattern(file);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    benchmark::Flags flags(argc, argv);
+    const string resource_dir = flags.Get("resource_dir", ".");
+    const string spec_file = flags.Get("spec", "src/parser_features.fml");
+    const string json_file = flags.Get("json", "");
+    const int num_states = flags.Get("states", 256);
+    const double min_time_ms = flags.Get("min_time_ms", 200.0);
+    vector<int> lengths;
+    for (const string &length : utils::Split(flags.Get("lengths", "10,25,50"), ',')) {
+        lengths.push_back(atoi(length.c_str()));
+    }
+
+    // The feature spec as the parser uses it, without newlines.
+    string spec = ReadFile(spec_file);
+    for (char &c : spec) {
+        if (c == '\n') c = ' ';
+    }
+
+    TaskContext context;
+    AddInput("word-map", resource_dir + "/word-map", &context);
+    AddInput("tag-map", resource_dir + "/tag-map", &context);
+    AddInput("label-map", resource_dir + "/label-map", &context);
+    context.SetParameter("parser_features", spec);
+    context.SetParameter("parser_embedding_names", "words;tags;labels");
+    context.SetParameter("parser_embedding_dims", "64;32;32");
+
+    BenchmarkFeatureExtractor features;
+    features.Setup(&context);
+    features.Init(&context);
+
+    vector<std::unique_ptr<ParserFeatureExtractor>> locators;
+    for (const auto &locator : kLocatorSpecs) {
+        locators.emplace_back(new ParserFeatureExtractor());
+        locators.back()->Parse(locator.second);
+        locators.back()->Setup(&context);
+        locators.back()->Init(&context);
+    }
+
+    WorkspaceRegistry registry;
+    features.RequestWorkspaces(&registry);
+    for (auto &locator : locators) locator->RequestWorkspaces(&registry);
+
+    const int min_freq = 0;
+    const int max_num_terms = 0;
+    const TermFrequencyMap *word_map =
+        SharedStoreUtils::GetWithDefaultName<TermFrequencyMap>(
+            resource_dir + "/word-map", min_freq, max_num_terms);
+    const TermFrequencyMap *tag_map =
+        SharedStoreUtils::GetWithDefaultName<TermFrequencyMap>(
+            resource_dir + "/tag-map", min_freq, max_num_terms);
+    const TermFrequencyMap *label_map =
+        SharedStoreUtils::GetWithDefaultName<TermFrequencyMap>(
+            resource_dir + "/label-map", min_freq, max_num_terms);
+
+    benchmark::Reporter reporter("feature_extraction");
+    std::mt19937 rng(20160712);
+    for (int length : lengths) {
+        for (const Shape &shape : kShapes) {
+            // Build the states: a random prefix of a full arc-standard
+            // derivation (2 * length transitions) of a random sentence.
+            vector<std::unique_ptr<Sentence>> sentences;
+            vector<std::unique_ptr<ParserState>> states;
+            vector<std::unique_ptr<WorkspaceSet>> workspaces;
+            for (int i = 0; i < num_states; ++i) {
+                sentences.emplace_back(
+                    RandomSentence(length, *word_map, *tag_map, &rng));
+                states.emplace_back(
+                    new ParserState(sentences.back().get(), nullptr, label_map));
+                RandomWalk(rng() % (2 * length), shape.reduce_probability,
+                           label_map->Size(), &rng, states.back().get());
+                workspaces.emplace_back(new WorkspaceSet());
+                workspaces.back()->Reset(registry);
+                features.Preprocess(workspaces.back().get(), states.back().get());
+                for (auto &locator : locators) {
+                    locator->Preprocess(workspaces.back().get(),
+                                        states.back().get());
+                }
+            }
+
+            // Foci for the tree navigation primitives.
+            vector<vector<int>> child_foci(num_states);
+            vector<vector<int>> sibling_foci(num_states);
+            for (int i = 0; i < num_states; ++i) {
+                for (int position = 0; position < 2; ++position) {
+                    const int focus = states[i]->Stack(position);
+                    if (focus < -1) continue;
+                    child_foci[i].push_back(focus);
+                    for (int child : {states[i]->LeftmostChild(focus, 1),
+                                      states[i]->RightmostChild(focus, 1)}) {
+                        if (child >= 0) sibling_foci[i].push_back(child);
+                    }
+                }
+            }
+
+            const vector<pair<string, string>> labels = {
+                {"length", utils::Printf(length)}, {"shape", shape.name}};
+            auto run = [&](const string &name, std::function<void()> body) {
+                benchmark::Result result =
+                    benchmark::Run(name, "state", num_states, min_time_ms, body);
+                result.labels = labels;
+                reporter.Add(result);
+            };
+
+            run("ParserState::LeftmostChild", [&]() {
+                int64_t sum = 0;
+                for (int i = 0; i < num_states; ++i) {
+                    for (int focus : child_foci[i]) {
+                        sum += states[i]->LeftmostChild(focus, 1) +
+                               states[i]->LeftmostChild(focus, 2);
+                    }
+                }
+                benchmark::DoNotOptimize(sum);
+            });
+            run("ParserState::RightmostChild", [&]() {
+                int64_t sum = 0;
+                for (int i = 0; i < num_states; ++i) {
+                    for (int focus : child_foci[i]) {
+                        sum += states[i]->RightmostChild(focus, 1) +
+                               states[i]->RightmostChild(focus, 2);
+                    }
+                }
+                benchmark::DoNotOptimize(sum);
+            });
+            run("ParserState::LeftSibling", [&]() {
+                int64_t sum = 0;
+                for (int i = 0; i < num_states; ++i) {
+                    for (int focus : sibling_foci[i]) {
+                        sum += states[i]->LeftSibling(focus, 1);
+                    }
+                }
+                benchmark::DoNotOptimize(sum);
+            });
+            run("ParserState::RightSibling", [&]() {
+                int64_t sum = 0;
+                for (int i = 0; i < num_states; ++i) {
+                    for (int focus : sibling_foci[i]) {
+                        sum += states[i]->RightSibling(focus, 1);
+                    }
+                }
+                benchmark::DoNotOptimize(sum);
+            });
+
+            FeatureVector locator_features;
+            for (size_t j = 0; j < locators.size(); ++j) {
+                run(kLocatorSpecs[j].first, [&]() {
+                    for (int i = 0; i < num_states; ++i) {
+                        locator_features.clear();
+                        locators[j]->ExtractFeatures(*workspaces[i], *states[i],
+                                                     &locator_features);
+                    }
+                    benchmark::DoNotOptimize(locator_features.size());
+                });
+            }
+
+            vector<FeatureVector> feature_vectors(features.NumEmbeddings());
+            vector<FeatureIds> feature_ids;
+            run("FeatureExtractor::ExtractFeatures", [&]() {
+                for (int i = 0; i < num_states; ++i) {
+                    features.ExtractFeatures(*workspaces[i], *states[i],
+                                             &feature_vectors);
+                }
+                benchmark::DoNotOptimize(feature_vectors[0].size());
+            });
+
+            vector<vector<FeatureVector>> extracted(num_states);
+            for (int i = 0; i < num_states; ++i) {
+                extracted[i].resize(features.NumEmbeddings());
+                features.ExtractFeatures(*workspaces[i], *states[i],
+                                         &extracted[i]);
+            }
+            run("ConvertExample", [&]() {
+                for (int i = 0; i < num_states; ++i) {
+                    features.ConvertExample(extracted[i], &feature_ids);
+                }
+                benchmark::DoNotOptimize(feature_ids[0].id(0));
+            });
+
+            run("ExtractSparseFeatures", [&]() {
+                for (int i = 0; i < num_states; ++i) {
+                    features.ExtractSparseFeatures(*workspaces[i], *states[i],
+                                                   &feature_vectors,
+                                                   &feature_ids);
+                }
+                benchmark::DoNotOptimize(feature_ids[0].id(0));
+            });
+
+            benchmark::Result result = benchmark::Run(
+                "ExtractFeatureIds", "state", num_states, min_time_ms, [&]() {
+                    for (int i = 0; i < num_states; ++i) {
+                        features.ExtractFeatureIds(*workspaces[i], *states[i],
+                                                   &feature_vectors,
+                                                   &feature_ids);
+                    }
+                    benchmark::DoNotOptimize(feature_ids[0].id(0));
+                });
+            result.labels = labels;
+            result.labels.emplace_back("compiled",
+                                       features.use_compiled() ? "true" : "false");
+            reporter.Add(result);
+        }
+    }
+
+    SharedStore::Release(word_map);
+    SharedStore::Release(tag_map);
+    SharedStore::Release(label_map);
+
+    if (!json_file.empty() && !reporter.WriteJson(json_file)) {
+        LOG(ERROR) << "Cannot write " << json_file;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,224 @@
+/*!
+ * \brief Microbenchmarks for reading CoNLL corpora.
+ *
+ * Reads a whole corpus per call and reports the time and allocations per
+ * sentence and the throughput in MB/s of the CoNLL corpus for:
+ *
+ *  - a reference copy of the reader before the zero-copy rewrite, which
+ *    reads records with std::getline and splits them into vectors of
+ *    strings,
+ *  - CoNLLSyntaxFormat reading records from a stream and parsing them in
+ *    place,
+ *  - TextReader, which reads the corpus in chunks and parses the records in
+ *    the chunks into recycled sentences, synchronously and with a background
+ *    prefetch thread (where the time is that of the consuming thread),
+ *  - TextReader on a copy of the corpus in the binary RecordIO sentence
+ *    format, which is written to --recordio,
+ *  - TextReader on gzip compressed copies of both, written to --gzip and
+ *    --recordio plus ".gz", which it decompresses as it reads.
+ *
+ * The TextReader results are labelled with the size of the files read per
+ * sentence.
+ *
+ * The corpus is read once up front so that all readers run from the page
+ * cache.
+ *
+ * Usage:
+ *
+ *   reader_benchmark --corpus=test/train.conll.utf8 [--prefetch=256]
+ *                    [--recordio=/tmp/corpus.rec]
+ *                    [--gzip=/tmp/corpus.conll.gz] [--min_time_ms=200]
+ *                    [--json=results.json]
+ */
+#include "benchmark.h"
+#include "../../dmlc-core/include/dmlc/recordio.h"
+#include "../io/compression.h"
+#include "../io/recordio_format.h"
+#include "../io/text_formats.h"
+#include "../io/text_reader.h"
+#include "../sentence.h"
+#include "../utils/task_context.h"
+
+namespace {
+
+// The CoNLL reader before the zero-copy rewrite.
+class ReferenceCoNLLReader {
+public:
+    bool ReadRecord(ifstream *stream, string *record) {
+        string line;
+        record->clear();
+        while (std::getline(*stream, line) && !line.empty()) {
+            record->append(line);
+            record->append("\n");
+        }
+        return !record->empty();
+    }
+
+    Sentence *Convert(const string &key, const string &value) {
+        Sentence *sentence = new Sentence();
+        string text;
+        vector<string> lines = utils::Split(value, '\n');
+        vector<string> fields;
+        int expected_id = 1;
+        for (size_t i = 0; i < lines.size(); ++i) {
+            fields.clear();
+            fields = utils::Split(lines[i], '\t');
+            if (fields.size() == 0) continue;
+            if (fields[0][0] == '#') continue;
+            CHECK_GE(fields.size(), 8);
+            const int id = utils::ParseUsing<int>(fields[0], 0, utils::ParseInt32);
+            CHECK_EQ(expected_id++, id);
+            const string &word = fields[1];
+            const string &cpostag = fields[3];
+            const string &tag = fields[4];
+            const int head = utils::ParseUsing<int>(fields[6], 0, utils::ParseInt32);
+            const string &label = fields[7];
+            if (!text.empty()) text.append(" ");
+            const int start = text.size();
+            const int end = start + word.size() - 1;
+            text.append(word);
+            Token *token = sentence->add_token();
+            token->set_word(word);
+            token->set_start(start);
+            token->set_end(end);
+            if (head > 0) token->set_head(head - 1);
+            if (!tag.empty()) token->set_tag(tag);
+            if (!cpostag.empty()) token->set_category(cpostag);
+            if (!label.empty()) token->set_label(label);
+        }
+        sentence->set_docid(key);
+        sentence->set_text(text);
+        return sentence;
+    }
+};
+
+// Counts the tokens of a sentence and deletes it.
+int64_t Consume(Sentence *sentence) {
+    const int64_t num_tokens = sentence->token_size();
+    delete sentence;
+    return num_tokens;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    benchmark::Flags flags(argc, argv);
+    const string corpus = flags.Get("corpus", "test/train.conll.utf8");
+    const string json_file = flags.Get("json", "");
+    const double min_time_ms = flags.Get("min_time_ms", 200.0);
+    const int prefetch = flags.Get("prefetch", 256);
+    const string recordio_file = flags.Get("recordio", "/tmp/corpus.rec");
+    const string gzip_file = flags.Get("gzip", "/tmp/corpus.conll.gz");
+
+    // Count the sentences and bytes and warm up the page cache.
+    TaskInput input;
+    input.add_part()->set_file_pattern(corpus);
+    int64_t num_sentences = 0;
+    {
+        // Also write the RecordIO and compressed copies.
+        RecordIOSentenceFormat format;
+        std::unique_ptr<dmlc::Stream> stream(
+            dmlc::Stream::Create(recordio_file.c_str(), "w"));
+        std::unique_ptr<dmlc::Stream> gzip_stream(
+            CreateCompressingOutput(recordio_file + ".gz"));
+        dmlc::RecordIOWriter writer(stream.get());
+        dmlc::RecordIOWriter gzip_writer(gzip_stream.get());
+        string key, value;
+        TextReader reader(input);
+        for (Sentence *sentence = reader.Read(); sentence != nullptr;
+             sentence = reader.Read()) {
+            format.ConvertToString(*sentence, &key, &value);
+            writer.WriteRecord(value);
+            gzip_writer.WriteRecord(value);
+            Consume(sentence);
+            ++num_sentences;
+        }
+
+        std::unique_ptr<dmlc::Stream> text(OpenDecompressingInput(corpus));
+        std::unique_ptr<dmlc::Stream> gzip_text(CreateCompressingOutput(gzip_file));
+        vector<char> buffer(1 << 20);
+        for (size_t size = text->Read(buffer.data(), buffer.size()); size > 0;
+             size = text->Read(buffer.data(), buffer.size())) {
+            gzip_text->Write(buffer.data(), size);
+        }
+    }
+    CHECK_GT(num_sentences, 0) << "Empty corpus: " << corpus;
+    auto FileSize = [](const string &file) -> int64_t {
+        ifstream stream(file, ios::binary | ios::ate);
+        return stream.tellg();
+    };
+    const int64_t num_bytes = FileSize(corpus);
+
+    benchmark::Reporter reporter("reader");
+    auto add = [&](benchmark::Result result) {
+        result.labels.emplace_back("sentences", utils::Printf(num_sentences));
+        result.bytes_per_item = static_cast<double>(num_bytes) / num_sentences;
+        reporter.Add(result);
+    };
+
+    add(benchmark::Run("reference", "sentence", num_sentences, min_time_ms, [&]() {
+        ReferenceCoNLLReader reader;
+        ifstream file(corpus);
+        string record;
+        int64_t num_tokens = 0;
+        while (reader.ReadRecord(&file, &record)) {
+            num_tokens += Consume(reader.Convert("0", record));
+        }
+        benchmark::DoNotOptimize(num_tokens);
+    }));
+
+    add(benchmark::Run("CoNLLSyntaxFormat(stream)", "sentence", num_sentences,
+                       min_time_ms, [&]() {
+        CoNLLSyntaxFormat format;
+        ifstream file(corpus);
+        string record;
+        vector<Sentence *> sentences;
+        int64_t num_tokens = 0;
+        while (format.ReadRecord(&file, &record)) {
+            format.ConvertFromString("0", record, &sentences);
+            for (Sentence *sentence : sentences) num_tokens += Consume(sentence);
+            sentences.clear();
+        }
+        benchmark::DoNotOptimize(num_tokens);
+    }));
+
+    vector<TaskInput> inputs(4);
+    const string files[] = {corpus, recordio_file, gzip_file, recordio_file + ".gz"};
+    for (int i = 0; i < 4; ++i) {
+        inputs[i].add_part()->set_file_pattern(files[i]);
+        if (i % 2 == 1) inputs[i].set_record_format("recordio-sentence");
+    }
+    for (const TaskInput &corpus_input : inputs) {
+        const string &file = corpus_input.part(0).file_pattern();
+        const string format = corpus_input.record_format().empty()
+                              ? "conll" : corpus_input.record_format();
+        for (int prefetch_size : {0, prefetch}) {
+            TextReader reader(corpus_input, prefetch_size);
+            benchmark::Result result = benchmark::Run(
+                "TextReader", "sentence", num_sentences, min_time_ms, [&]() {
+                    reader.Reset();
+                    int64_t num_tokens = 0;
+                    for (Sentence *sentence = reader.Read(); sentence != nullptr;
+                         sentence = reader.Read()) {
+                        num_tokens += sentence->token_size();
+                        reader.Release(sentence);
+                    }
+                    benchmark::DoNotOptimize(num_tokens);
+                });
+            result.labels.emplace_back("format", format);
+            result.labels.emplace_back(
+                "compression", FileCompression(file) == kGzip ? "gzip" : "none");
+            result.labels.emplace_back("prefetch", utils::Printf(prefetch_size));
+            result.labels.emplace_back(
+                "file_bytes_per_sentence",
+                utils::Printf(FileSize(file) / num_sentences));
+            add(result);
+        }
+    }
+
+    if (!json_file.empty() && !reporter.WriteJson(json_file)) {
+        LOG(ERROR) << "Cannot write " << json_file;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+/*!
+ * \brief Microbenchmarks for term map lookups.
+ *
+ * Loads a term map (by default the word-map, the largest one) and times
+ * lookups of a shuffled query set in which a given fraction of the queries
+ * are not in the map:
+ *
+ *  - TermFrequencyMap::LookupIndex on the std::string forms held by the
+ *    tokens, as the token lookup features call it,
+ *  - the same lookups through a std::unordered_map<string, int>, both on the
+ *    token strings and on a copy of each form (the way Word::ComputeValue
+ *    used to look words up), as a reference.
+ *
+ * Load() itself is timed per term for the text map and for a binary copy of
+ * it, which is written to --binary_map; lookups are timed on both.
+ *
+ * Usage:
+ *
+ *   term_map_benchmark [--map=word-map] [--binary_map=/tmp/term_map.bin]
+ *                      [--queries=65536] [--miss_rates=0,0.1,0.5]
+ *                      [--min_time_ms=200] [--json=results.json]
+ */
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+
+#include "benchmark.h"
+#include "../lexicon/term_frequency_map.h"
+
+int main(int argc, char **argv) {
+    benchmark::Flags flags(argc, argv);
+    const string map_file = flags.Get("map", "word-map");
+    const string binary_file = flags.Get("binary_map", "/tmp/term_map.bin");
+    const string json_file = flags.Get("json", "");
+    const int num_queries = flags.Get("queries", 65536);
+    const double min_time_ms = flags.Get("min_time_ms", 200.0);
+    vector<double> miss_rates;
+    for (const string &rate : utils::Split(flags.Get("miss_rates", "0,0.1,0.5"), ',')) {
+        miss_rates.push_back(atof(rate.c_str()));
+    }
+
+    benchmark::Reporter reporter("term_map");
+    TermFrequencyMap map(map_file, 0, 0);
+    CHECK_GT(map.Size(), 0) << "Empty term map: " << map_file;
+    map.SaveBinary(binary_file);
+    TermFrequencyMap mapped(binary_file, 0, 0);
+    CHECK(mapped.mapped());
+    const TermFrequencyMap *maps[] = {&map, &mapped};
+    for (const TermFrequencyMap *source : maps) {
+        const string &file = source->mapped() ? binary_file : map_file;
+        benchmark::Result result = benchmark::Run(
+            "TermFrequencyMap::Load", "term", map.Size(), min_time_ms, [&]() {
+                TermFrequencyMap loaded(file, 0, 0);
+                benchmark::DoNotOptimize(loaded.Size());
+            });
+        result.labels.emplace_back("terms", utils::Printf(map.Size()));
+        result.labels.emplace_back("format", source->mapped() ? "binary" : "text");
+        reporter.Add(result);
+    }
+
+    // Reference hash map with the same contents.
+    std::unordered_map<string, int> reference;
+    for (int i = 0; i < map.Size(); ++i) reference[map.GetTerm(i)] = i;
+
+    std::mt19937 rng(20160712);
+    for (double miss_rate : miss_rates) {
+        // Queries are drawn uniformly from the map; misses are terms with a
+        // byte appended, which share their prefix and most of their length.
+        vector<string> queries;
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        for (int i = 0; i < num_queries; ++i) {
+            string query = map.GetTerm(rng() % map.Size());
+            if (uniform(rng) < miss_rate) query.push_back('\x01');
+            queries.push_back(query);
+        }
+        std::shuffle(queries.begin(), queries.end(), rng);
+
+        vector<pair<string, string>> labels;
+        labels.emplace_back("terms", utils::Printf(map.Size()));
+        labels.emplace_back("miss_rate", utils::Printf(miss_rate));
+
+        for (const TermFrequencyMap *source : maps) {
+            benchmark::Result result = benchmark::Run(
+                "TermFrequencyMap::LookupIndex", "lookup", num_queries,
+                min_time_ms, [&]() {
+                    int64_t sum = 0;
+                    for (const string &query : queries) {
+                        sum += source->LookupIndex(query, -1);
+                    }
+                    benchmark::DoNotOptimize(sum);
+                });
+            result.labels = labels;
+            result.labels.emplace_back("format",
+                                       source->mapped() ? "binary" : "text");
+            reporter.Add(result);
+        }
+
+        benchmark::Result result = benchmark::Run(
+            "unordered_map::find", "lookup", num_queries, min_time_ms, [&]() {
+                int64_t sum = 0;
+                for (const string &query : queries) {
+                    auto it = reference.find(query);
+                    sum += it != reference.end() ? it->second : -1;
+                }
+                benchmark::DoNotOptimize(sum);
+            });
+        result.labels = labels;
+        reporter.Add(result);
+
+        result = benchmark::Run(
+            "unordered_map::find(copy)", "lookup", num_queries, min_time_ms,
+            [&]() {
+                int64_t sum = 0;
+                for (const string &query : queries) {
+                    const string form = query;
+                    auto it = reference.find(form);
+                    sum += it != reference.end() ? it->second : -1;
+                }
+                benchmark::DoNotOptimize(sum);
+            });
+        result.labels = labels;
+        reporter.Add(result);
+    }
+
+    if (!json_file.empty() && !reporter.WriteJson(json_file)) {
+        LOG(ERROR) << "Cannot write " << json_file;
+        return 1;
+    }
+    return 0;
+}
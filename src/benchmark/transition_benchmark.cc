@@ -0,0 +1,296 @@
+/*!
+ * \brief Compares transition systems by greedy decoding speed.
+ *
+ * Parses a corpus greedily with each registered transition system named by
+ * --systems, scoring every state with a GreedyNetwork of random weights (the
+ * native forward pass, as a trained network costs the same) and taking the
+ * allowed action of the highest score, as DecodedParseReader does. Reports
+ * the time per sentence of feature extraction, forward passes and
+ * transitions together, and labels each result with
+ *
+ *  - forwards_per_sentence: the forward passes of the greedy parses,
+ *  - gold_per_sentence: the transitions of the gold derivations, which a
+ *    trained network would follow,
+ *  - actions: the size of the softmax layer,
+ *  - tokens_per_s: the parsing throughput.
+ *
+ * It also times the transitions alone, "DecodeStep", on fixed random scores
+ * in place of the network: choosing the best allowed action with one virtual
+ * IsAllowedAction() call per action and a virtual PerformAction() (dispatch
+ * "virtual"), or with PerformBestAllowedAction(), which checks each action
+ * type once and inlines the concrete transition system (dispatch
+ * "templated").
+ *
+ * The corpus is read into memory up front.
+ *
+ * Usage (from the directory holding word-map, tag-map and label-map):
+ *
+ *   transition_benchmark --corpus=test/train.conll.utf8
+ *                        [--systems=arc-standard,arc-swift]
+ *                        [--resource_dir=.] [--spec=src/parser_features.fml]
+ *                        [--hidden_layer_sizes=200,200]
+ *                        [--arc_swift_max_distance=8] [--min_time_ms=200]
+ *                        [--json=results.json]
+ */
+#include <fstream>
+#include <memory>
+#include <random>
+#include <sstream>
+
+#include "benchmark.h"
+#include "../feature/embedding_feature_extractor.h"
+#include "../io/text_reader.h"
+#include "../lexicon/term_frequency_map.h"
+#include "../model/greedy_network.h"
+#include "../parser/parser_state.h"
+#include "../parser/parser_transitions.h"
+#include "../sentence.h"
+#include "../utils/shared_store.h"
+#include "../utils/task_context.h"
+#include "../utils/work_space.h"
+
+namespace {
+
+// Reads a whole file into a string.
+string ReadFile(const string &path) {
+    std::ifstream file(path);
+    CHECK(file) << "Cannot read " << path;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+// Adds an input with a single file to the task context.
+void AddInput(const string &name, const string &file, TaskContext *context) {
+    TaskInput *input = context->mutable_spec()->add_input();
+    input->set_name(name);
+    input->add_part()->set_file_pattern(file);
+}
+
+// Formats a number with the given digits after the point.
+string FormatDouble(double value, int digits) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+    return buffer;
+}
+
+// Feature extraction, network and transition system of a greedy parser.
+class GreedyDecoder {
+public:
+    GreedyDecoder(TaskContext *context, const TermFrequencyMap *label_map,
+                  const vector<int> &hidden_layer_sizes)
+        : features_("parser"), label_map_(label_map) {
+        features_.Setup(context);
+        transition_system_.reset(ParserTransitionSystem::Create(
+            context->Get("parser_transition_system", "arc-standard")));
+        transition_system_->Setup(context);
+        features_.Init(context);
+        transition_system_->Init(context);
+        features_.RequestWorkspaces(&registry_);
+        feature_vectors_.resize(features_.NumEmbeddings());
+
+        GreedyNetwork::Spec spec;
+        for (int g = 0; g < features_.NumEmbeddings(); ++g) {
+            spec.num_features.push_back(features_.FeatureSize(g));
+            spec.num_feature_ids.push_back(features_.EmbeddingSize(g));
+            spec.embedding_dims.push_back(features_.EmbeddingDims(g));
+        }
+        spec.hidden_layer_sizes = hidden_layer_sizes;
+        spec.num_actions = transition_system_->NumActions(label_map->Size());
+        network_.reset(new GreedyNetwork(spec));
+        network_->InitializeUniform(0.2, 1);
+        network_->InitActivations(&activations_);
+        row_.resize(network_->num_feature_ids());
+    }
+
+    // Parses a sentence and returns the number of forward passes.
+    int Parse(Sentence *sentence) {
+        ParserState state(sentence, transition_system_->NewTransitionState(false),
+                          label_map_);
+        workspace_.Reset(registry_);
+        features_.Preprocess(&workspace_, &state);
+        const int num_actions = network_->spec().num_actions;
+        const float *scores = activations_.layer(network_->num_layers());
+        int num_forwards = 0;
+        while (!transition_system_->IsFinalState(state)) {
+            features_.ExtractFeatureIds(workspace_, state, &feature_vectors_,
+                                        &feature_ids_);
+            int32_t *column = row_.data();
+            for (const FeatureIds &ids : feature_ids_) {
+                column = std::copy(ids.data(), ids.data() + ids.size(), column);
+            }
+            network_->Forward(row_.data(), &activations_);
+            ++num_forwards;
+            transition_system_->PerformBestAllowedAction(scores, num_actions, &allowed_,
+                                                         &state);
+        }
+        return num_forwards;
+    }
+
+    // Parses a sentence greedily on the rows of a table of scores, in turn,
+    // and returns the number of transitions.
+    int Decode(Sentence *sentence, const vector<float> &table, bool virtual_dispatch) {
+        ParserState state(sentence, transition_system_->NewTransitionState(false),
+                          label_map_);
+        const int num_actions = network_->spec().num_actions;
+        const int num_rows = table.size() / num_actions;
+        int num_transitions = 0;
+        while (!transition_system_->IsFinalState(state)) {
+            const float *scores = table.data() + (num_transitions % num_rows) * num_actions;
+            if (virtual_dispatch) {
+                ParserAction best = 0;
+                float best_score = -std::numeric_limits<float>::max();
+                for (ParserAction action = 0; action < num_actions; ++action) {
+                    if (scores[action] > best_score &&
+                        transition_system_->IsAllowedAction(action, state)) {
+                        best = action;
+                        best_score = scores[action];
+                    }
+                }
+                transition_system_->PerformAction(best, &state);
+            } else {
+                transition_system_->PerformBestAllowedAction(scores, num_actions, &allowed_,
+                                                             &state);
+            }
+            ++num_transitions;
+        }
+        return num_transitions;
+    }
+
+    // Returns the number of transitions of the gold derivation.
+    int GoldDerivationLength(Sentence *sentence) const {
+        ParserState state(sentence, transition_system_->NewTransitionState(true),
+                          label_map_);
+        int length = 0;
+        while (!transition_system_->IsFinalState(state)) {
+            transition_system_->PerformActionWithoutHistory(
+                transition_system_->GetNextGoldAction(state), &state);
+            ++length;
+        }
+        return length;
+    }
+
+    int num_actions() const { return network_->spec().num_actions; }
+
+private:
+    ParserEmbeddingFeatureExtractor features_;
+    std::unique_ptr<ParserTransitionSystem> transition_system_;
+    std::unique_ptr<GreedyNetwork> network_;
+    const TermFrequencyMap *label_map_;
+    WorkspaceRegistry registry_;
+    WorkspaceSet workspace_;
+    vector<FeatureVector> feature_vectors_;
+    vector<FeatureIds> feature_ids_;
+    vector<int32_t> row_;
+    vector<uint8_t> allowed_;
+    GreedyNetwork::Activations activations_;
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    benchmark::Flags flags(argc, argv);
+    const string corpus = flags.Get("corpus", "test/train.conll.utf8");
+    const string resource_dir = flags.Get("resource_dir", ".");
+    const string spec_file = flags.Get("spec", "src/parser_features.fml");
+    const string json_file = flags.Get("json", "");
+    const double min_time_ms = flags.Get("min_time_ms", 200.0);
+    const int max_distance = flags.Get("arc_swift_max_distance", 8);
+    vector<int> hidden_layer_sizes;
+    for (const string &size : utils::Split(flags.Get("hidden_layer_sizes", "200,200"), ',')) {
+        hidden_layer_sizes.push_back(atoi(size.c_str()));
+    }
+
+    // The feature spec as the parser uses it, without newlines.
+    string spec = ReadFile(spec_file);
+    for (char &c : spec) {
+        if (c == '\n') c = ' ';
+    }
+    TaskContext context;
+    AddInput("word-map", resource_dir + "/word-map", &context);
+    AddInput("tag-map", resource_dir + "/tag-map", &context);
+    AddInput("label-map", resource_dir + "/label-map", &context);
+    context.SetParameter("parser_features", spec);
+    context.SetParameter("parser_embedding_names", "words;tags;labels");
+    context.SetParameter("parser_embedding_dims", "64;32;32");
+    context.SetParameter("arc_swift_max_distance", utils::Printf(max_distance));
+
+    // The whole corpus, kept unreleased.
+    TaskInput input;
+    input.add_part()->set_file_pattern(corpus);
+    TextReader reader(input);
+    vector<Sentence *> sentences;
+    int64_t num_tokens = 0;
+    for (Sentence *sentence = reader.Read(); sentence != nullptr; sentence = reader.Read()) {
+        sentences.push_back(sentence);
+        num_tokens += sentence->token_size();
+    }
+    CHECK(!sentences.empty()) << "Empty corpus: " << corpus;
+    const int64_t num_sentences = sentences.size();
+
+    const string label_map_path = resource_dir + "/label-map";
+    const TermFrequencyMap *label_map =
+        SharedStoreUtils::GetWithDefaultName<TermFrequencyMap>(label_map_path, 0, 0);
+
+    benchmark::Reporter reporter("transition_systems");
+    for (const string &system : utils::Split(flags.Get("systems", "arc-standard,arc-swift"), ',')) {
+        context.SetParameter("parser_transition_system", system);
+        GreedyDecoder decoder(&context, label_map, hidden_layer_sizes);
+        int64_t num_forwards = 0;
+        int64_t num_gold = 0;
+        for (Sentence *sentence : sentences) {
+            num_forwards += decoder.Parse(sentence);
+            num_gold += decoder.GoldDerivationLength(sentence);
+        }
+
+        benchmark::Result result = benchmark::Run(
+            "GreedyParse", "sentence", num_sentences, min_time_ms, [&]() {
+                int64_t forwards = 0;
+                for (Sentence *sentence : sentences) forwards += decoder.Parse(sentence);
+                benchmark::DoNotOptimize(forwards);
+            });
+        const double ns_per_token = result.ns_per_item * num_sentences / num_tokens;
+        result.labels.emplace_back("system", system);
+        result.labels.emplace_back("actions", utils::Printf(decoder.num_actions()));
+        result.labels.emplace_back(
+            "forwards_per_sentence",
+            FormatDouble(static_cast<double>(num_forwards) / num_sentences, 2));
+        result.labels.emplace_back(
+            "gold_per_sentence",
+            FormatDouble(static_cast<double>(num_gold) / num_sentences, 2));
+        result.labels.emplace_back("tokens_per_s", FormatDouble(1e9 / ns_per_token, 0));
+        reporter.Add(result);
+
+        // The transitions alone.
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> uniform(0, 1);
+        vector<float> table(64 * decoder.num_actions());
+        for (float &score : table) score = uniform(rng);
+        int64_t num_transitions = 0;
+        for (Sentence *sentence : sentences) {
+            num_transitions += decoder.Decode(sentence, table, false);
+        }
+        for (bool virtual_dispatch : {true, false}) {
+            benchmark::Result step = benchmark::Run(
+                "DecodeStep", "transition", num_transitions, min_time_ms, [&]() {
+                    int64_t transitions = 0;
+                    for (Sentence *sentence : sentences) {
+                        transitions += decoder.Decode(sentence, table, virtual_dispatch);
+                    }
+                    benchmark::DoNotOptimize(transitions);
+                });
+            step.labels.emplace_back("system", system);
+            step.labels.emplace_back("actions", utils::Printf(decoder.num_actions()));
+            step.labels.emplace_back("dispatch", virtual_dispatch ? "virtual" : "templated");
+            reporter.Add(step);
+        }
+    }
+
+    for (Sentence *sentence : sentences) reader.Release(sentence);
+    SharedStore::Release(label_map);
+    if (!json_file.empty() && !reporter.WriteJson(json_file)) {
+        LOG(ERROR) << "Cannot write " << json_file;
+        return 1;
+    }
+    return 0;
+}
@@ -1,4 +1,6 @@
 #include <iostream>
+#include "io/npy_writer.h"
+#include "io/text_formats.h"
 #include "reader_ops.cc"
 #include "options.h"
 #include "lexicon/lexicon_builder.cc"
@@ -167,14 +169,11 @@ int TestLexiconBuilder(int argc, char *argv[]) {
             transition_system_->PerformActionWithoutHistory(action, state);
             LOG(INFO) << "Parser State: " << state->ToString();
 
-            vector<vector<SparseFeatures>> features = features_->ExtractSparseFeatures(workspace, *state);
+            vector<FeatureIds> features = features_->ExtractSparseFeatures(workspace, *state);
             cout << action << "";
             for (size_t i = 0; i < features.size(); ++i) {
-                for (size_t j = 0; j < features[i].size(); ++j) {
-                    SparseFeatures sf = features[i][j];
-                    for (uint64_t id : sf.id_) {
-                        cout << id << "";
-                    }
+                for (int j = 0; j < features[i].size(); ++j) {
+                    cout << features[i].id(j) << "";
                 }
             }
             cout << endl;
@@ -278,12 +277,14 @@ int TestParserEmbeddingFeatureExtractor(int argc, char *argv[]) {
             ParserAction action = transition_system_->GetNextGoldAction(*state);
             string action_string = transition_system_->ActionAsString(action, *state);
 
-            vector<vector<SparseFeatures>> features = features_->ExtractSparseFeatures(workspace, *state);
+            vector<FeatureIds> features = features_->ExtractSparseFeatures(workspace, *state);
             cout << action << "";
             for (size_t i = 0; i < features.size(); ++i) {
-                for (size_t j = 0; j < features[i].size(); ++j) {
-                  cout << features[i][j].id_[0] << "";
+                for (int j = 0; j < features[i].size(); ++j) {
+                  cout << features[i].id(j) << "";
                 }
+                LOG(INFO) << "Features: " << utils::Join(
+                        features_->FeatureDescriptions(i, features[i]), " ");
             }
             cout << endl;
 
@@ -296,7 +297,8 @@ int TestParserEmbeddingFeatureExtractor(int argc, char *argv[]) {
     }
 }
 
-int TestReaderOP(int argc, char *argv[]) {
+// Returns the parser config of the reader tests.
+TaskContext *NewReaderContext() {
     // Init Parser Config.
     TaskContext *context = new TaskContext();
     TaskSpec *spec = context->mutable_spec();
@@ -333,6 +335,14 @@ int TestReaderOP(int argc, char *argv[]) {
     TaskSpec::Parameter *embedding_dims = spec->add_parameter();
     embedding_dims->set_name("parser_embedding_dims");
     embedding_dims->set_value("64;32;32");
+    return context;
+}
+
+int TestReaderOP(int argc, char *argv[]) {
+    TaskContext *context = NewReaderContext();
+
+    // The parses go to the file given as the first argument, if any.
+    if (argc > 1) context->SetParameter("output_file", argv[1]);
 
     DecodedParseReader *decoder = new DecodedParseReader(context);
     while (true) {
@@ -346,11 +356,42 @@ int TestReaderOP(int argc, char *argv[]) {
     decoder->OutputCoNLLResult();
 }
 
+// Writes the examples of one epoch of exploration, the features of each
+// state and its oracle label, to the .npy files prefixed by the first argument.
+int TestExplorationReader(int argc, char *argv[]) {
+    TaskContext *context = NewReaderContext();
+    const string prefix = argc > 1 ? argv[1] : "exploration";
+
+    ExplorationParseReader *reader = new ExplorationParseReader(context);
+    NpyWriter feature_rows(prefix + "-features.npy", 20 + 20 + 12);
+    NpyWriter labels(prefix + "-labels.npy", 0);
+    vector<int32_t> row;
+    while (true) {
+      reader->Compute();
+      if (reader->num_epochs() > 1) {
+        break;
+      }
+      reader->ComputeMatrix();
+      for (size_t i = 0; i < reader->oracle_actions_.size(); ++i) {
+        row.clear();
+        for (const vector<float> &group : reader->feature_outputs_) {
+          const size_t size = group.size() / reader->scores_matrix_.row_;
+          row.insert(row.end(), group.begin() + i * size, group.begin() + (i + 1) * size);
+        }
+        feature_rows.Write(row.data());
+        labels.Write(reader->oracle_actions_[i]);
+      }
+    }
+    LOG(INFO) << "Wrote " << labels.num_rows() << " exploration examples.";
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
     // TestLexiconBuilder(argc, argv);
     // TestEmbeddingFeatureExtractor(argc, argv);
     // TestTaggerSystem(argc, argv);
     // TestParserEmbeddingFeatureExtractor(argc, argv);
+    // TestExplorationReader(argc, argv);
     TestReaderOP(argc, argv);
     return 0;
 }
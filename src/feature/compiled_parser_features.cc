@@ -0,0 +1,124 @@
+#include "compiled_parser_features.h"
+
+#include "feature_extractor.h"
+#include "../fml/fml_parser.h"
+#include "../lexicon/term_frequency_map.h"
+#include "../utils/shared_store.h"
+
+#ifdef SYNTAXNET_COMPILED_PARSER_FEATURES
+// Generated by fml_codegen from SYNTAXNET_COMPILED_FEATURES_SPEC.
+#include "compiled_parser_features_spec.h"
+#endif
+
+using namespace compiled_parser_features;
+
+namespace {
+
+// Returns the canonical FML of a feature group, see ToFML().
+string CanonicalFML(const string &spec) {
+    FeatureExtractorDescriptor descriptor;
+    FMLParser parser;
+    parser.Parse(spec, &descriptor);
+    string output;
+    ToFML(descriptor, &output);
+    return output;
+}
+
+// Workspace name of a TermFrequencyMapFeature with default parameters.
+string WorkspaceName(const string &input_name) {
+    const string prefix = "term-frequency-map";
+    const int min_freq = 0;
+    const int max_num_terms = 0;
+    return SharedStoreUtils::CreateDefaultName(prefix, input_name, min_freq,
+                                               max_num_terms);
+}
+
+}  // namespace
+
+CompiledParserFeatures::~CompiledParserFeatures() {
+    if (word_map_ != nullptr) SharedStore::Release(word_map_);
+    if (tag_map_ != nullptr) SharedStore::Release(tag_map_);
+    if (label_map_ != nullptr) SharedStore::Release(label_map_);
+}
+
+string CompiledParserFeatures::CompiledSpec() {
+#ifdef SYNTAXNET_COMPILED_PARSER_FEATURES
+    return kCompiledSpec;
+#else
+    return "";
+#endif
+}
+
+bool CompiledParserFeatures::Init(TaskContext *context,
+                                  const vector<string> &embedding_fml) {
+#ifdef SYNTAXNET_COMPILED_PARSER_FEATURES
+    vector<string> groups;
+    for (const string &fml : embedding_fml) groups.push_back(CanonicalFML(fml));
+    const string spec = utils::Join(groups, ";");
+    if (spec != kCompiledSpec) {
+        LOG(INFO) << "Feature spec differs from the compiled one, "
+                  << "using the generic feature extractor.";
+        return false;
+    }
+    if (kUsesWords) word_map_ = GetTermMap(context, "word-map", &resources_.words);
+    if (kUsesTags) tag_map_ = GetTermMap(context, "tag-map", &resources_.tags);
+    if (kUsesLabels) {
+        label_map_ = GetTermMap(context, "label-map", &resources_.labels);
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+const TermFrequencyMap *CompiledParserFeatures::GetTermMap(
+        TaskContext *context, const string &input_name, TokenValues *values) {
+    // Same resource as TermFrequencyMapFeature with default parameters; the
+    // generator rejects specs with min-freq or max-num-terms.
+    const string file_name = context->InputFile(*context->GetInput(input_name));
+    const int min_freq = 0;
+    const int max_num_terms = 0;
+    const TermFrequencyMap *term_map =
+        SharedStoreUtils::GetWithDefaultName<TermFrequencyMap>(
+            file_name, min_freq, max_num_terms);
+
+    // TokenLookupFeature returns NumValues() = Size() + 1 outside the sentence,
+    // and the root value is the size of its domain, which includes <OUTSIDE>.
+    values->outside = term_map->Size() + 1;
+    values->root = term_map->Size() + 2;
+    return term_map;
+}
+
+void CompiledParserFeatures::RequestWorkspaces(WorkspaceRegistry *registry) {
+    if (word_map_ != nullptr) {
+        word_workspace_ =
+            registry->Request<VectorIntWorkspace>(WorkspaceName("word-map"));
+    }
+    if (tag_map_ != nullptr) {
+        tag_workspace_ =
+            registry->Request<VectorIntWorkspace>(WorkspaceName("tag-map"));
+    }
+}
+
+void CompiledParserFeatures::Extract(const WorkspaceSet &workspaces,
+                                     const ParserState &state,
+                                     vector<FeatureIds> *feature_ids) const {
+#ifdef SYNTAXNET_COMPILED_PARSER_FEATURES
+    Resources resources = resources_;
+    if (word_workspace_ >= 0) {
+        resources.words.values =
+            &workspaces.Get<VectorIntWorkspace>(word_workspace_);
+    }
+    if (tag_workspace_ >= 0) {
+        resources.tags.values = &workspaces.Get<VectorIntWorkspace>(tag_workspace_);
+    }
+    feature_ids->resize(kNumGroups);
+    for (int i = 0; i < kNumGroups; ++i) {
+        FeatureIds &ids = (*feature_ids)[i];
+        ids.Reset(kGroupSizes[i]);
+        kExtractFunctions[i](state, resources, ids.mutable_data());
+    }
+#else
+    LOG(FATAL) << "No compiled feature extractor.";
+#endif
+}
@@ -0,0 +1,210 @@
+/*!
+ * \brief Compile-time specialized parser feature extraction.
+ *
+ * A fixed FML spec can be turned into a header by fml_codegen (see
+ * src/fml/fml_codegen.cc) in which every feature is a type composed from the
+ * templates below, e.g. "stack(1).child(-1).sibling(1).word" becomes
+ *
+ *   Word<Sibling<Child<Stack<1>, -1>, 1>>
+ *
+ * Extracting a feature group is then a sequence of inlined locator calls on
+ * ParserState with no registry lookups, no virtual calls and no FeatureVector.
+ * The values are identical to the ones produced by the generic
+ * ParserFeatureExtractor for the same spec.
+ *
+ * The word and tag values are read from the VectorIntWorkspaces filled by the
+ * generic TokenLookupFeature preprocessing, so the generic extractor still has
+ * to Preprocess() each state.
+ */
+#ifndef COMPILED_PARSER_FEATURES_H_
+#define COMPILED_PARSER_FEATURES_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "sparse_features.h"
+#include "../parser/parser_state.h"
+#include "../utils/task_context.h"
+#include "../utils/work_space.h"
+
+class TermFrequencyMap;
+
+namespace compiled_parser_features {
+
+// Values of a token lookup feature (word, tag, label) for one parser state.
+struct TokenValues {
+    // Preprocessed value per token, or null for features read from the state.
+    const VectorIntWorkspace *values = nullptr;
+
+    // Value for foci outside the sentence.
+    int32_t outside = 0;
+
+    // Value for the artificial root token.
+    int32_t root = 0;
+};
+
+// Everything the compiled features need besides the parser state.
+struct Resources {
+    TokenValues words;
+    TokenValues tags;
+    TokenValues labels;
+};
+
+// Locators. Focus() returns the token index the feature is computed for, with
+// -1 being the root and -2 "no such token", exactly like the generic ones.
+
+// "input(offset)": token relative to the next input token.
+template<int kOffset>
+struct Input {
+    static int Focus(const ParserState &state) { return state.Input(kOffset); }
+};
+
+// "stack(position)": token at a position on the stack.
+template<int kPosition>
+struct Stack {
+    static int Focus(const ParserState &state) {
+        return state.Stack(kPosition);
+    }
+};
+
+// "head(levels)": ancestor of the parent locator's focus.
+template<class P, int kLevels>
+struct Head {
+    static int Focus(const ParserState &state) {
+        const int focus = P::Focus(state);
+        if (focus < -1 || focus >= state.NumTokens()) return -2;
+        return state.Parent(focus, kLevels);
+    }
+};
+
+// "child(levels)": leftmost (levels < 0) or rightmost (levels > 0) child.
+template<class P, int kLevels>
+struct Child {
+    static int Focus(const ParserState &state) {
+        const int focus = P::Focus(state);
+        if (focus < -1 || focus >= state.NumTokens()) return -2;
+        return kLevels < 0 ? state.LeftmostChild(focus, -kLevels)
+                           : state.RightmostChild(focus, kLevels);
+    }
+};
+
+// "sibling(position)": left (position < 0) or right (position > 0) sibling.
+template<class P, int kPosition>
+struct Sibling {
+    static int Focus(const ParserState &state) {
+        const int focus = P::Focus(state);
+        if (focus < -1 || focus >= state.NumTokens()) return -2;
+        return kPosition < 0 ? state.LeftSibling(focus, -kPosition)
+                             : state.RightSibling(focus, kPosition);
+    }
+};
+
+// Leaf features.
+
+// Returns the preprocessed value of a token lookup feature.
+inline int32_t LookupValue(const ParserState &state, const TokenValues &values,
+                           int focus) {
+    if (focus == -1) return values.root;
+    if (focus < 0 || focus >= state.NumTokens()) return values.outside;
+    return values.values->element(focus);
+}
+
+// "word": word id of the focus token.
+template<class L>
+struct Word {
+    static int32_t Compute(const ParserState &state, const Resources &r) {
+        return LookupValue(state, r.words, L::Focus(state));
+    }
+};
+
+// "tag": POS tag id of the focus token.
+template<class L>
+struct Tag {
+    static int32_t Compute(const ParserState &state, const Resources &r) {
+        return LookupValue(state, r.tags, L::Focus(state));
+    }
+};
+
+// "label": label of the arc assigned to the focus token so far.
+template<class L>
+struct Label {
+    static int32_t Compute(const ParserState &state, const Resources &r) {
+        const int focus = L::Focus(state);
+        if (focus == -1) return r.labels.root;
+        if (focus < -1 || focus >= state.NumTokens()) return r.labels.outside;
+        const int label = state.Label(focus);
+        return label == -1 ? r.labels.root : label;
+    }
+};
+
+// A feature group (one embedding space): extracts all features in order.
+template<class ...F>
+struct Group {
+    static constexpr int kSize = sizeof...(F);
+
+    static void Extract(const ParserState &state, const Resources &r,
+                        int32_t *output) {
+        // Braced initializers are evaluated left to right.
+        int i = 0;
+        const int order[] = {(output[i++] = F::Compute(state, r), 0)...};
+        (void) order;
+    }
+};
+
+// Signature of the per-group extraction functions in the generated header.
+typedef void (*ExtractFunction)(const ParserState &state, const Resources &r,
+                                int32_t *output);
+
+}  // namespace compiled_parser_features
+
+/*!
+ * \brief Runtime wrapper around the feature extractor compiled from a fixed FML
+ * spec. It is only used if the build was configured with a spec (see
+ * SYNTAXNET_COMPILED_FEATURES_SPEC in CMakeLists.txt) and the spec given to
+ * Init() matches the compiled one; callers fall back to the generic extractor
+ * otherwise.
+ */
+class CompiledParserFeatures {
+public:
+    CompiledParserFeatures() {}
+
+    ~CompiledParserFeatures();
+
+    // Returns the spec the extractor was compiled from in canonical FML, with
+    // feature groups separated by ';', or an empty string if none was.
+    static string CompiledSpec();
+
+    // Initializes the extractor for the given per-group FML specs. Returns false
+    // if no extractor was compiled in or if its spec differs.
+    bool Init(TaskContext *context, const vector<string> &embedding_fml);
+
+    // Requests the preprocessed token value workspaces. These are shared with
+    // the generic extractor, which fills them in Preprocess().
+    void RequestWorkspaces(WorkspaceRegistry *registry);
+
+    // Extracts one FeatureIds per feature group.
+    void Extract(const WorkspaceSet &workspaces, const ParserState &state,
+                 vector<FeatureIds> *feature_ids) const;
+
+private:
+    // Gets a term map from the SharedStore and sets the outside/root values
+    // the same way TokenLookupFeature and ParserSentenceFeatureFunction do.
+    const TermFrequencyMap *GetTermMap(TaskContext *context,
+                                       const string &input_name,
+                                       compiled_parser_features::TokenValues *values);
+
+    // Term maps, owned through the SharedStore.
+    const TermFrequencyMap *word_map_ = nullptr;
+    const TermFrequencyMap *tag_map_ = nullptr;
+    const TermFrequencyMap *label_map_ = nullptr;
+
+    // Workspace indices of the preprocessed word and tag values.
+    int word_workspace_ = -1;
+    int tag_workspace_ = -1;
+
+    // Value templates; the workspaces are filled in per state.
+    compiled_parser_features::Resources resources_;
+};
+
+#endif
@@ -1,5 +1,7 @@
 #include "embedding_feature_extractor.h"
 
+constexpr int32_t FeatureIds::kNoFeature;
+
 void GenericEmbeddingFeatureExtractor::Setup(TaskContext *context) {
   // Don't use version to determine how to get feature FML.
   const string features = context->Get(ArgPrefix() + "_features", "");
@@ -9,7 +11,6 @@ void GenericEmbeddingFeatureExtractor::Setup(TaskContext *context) {
   LOG(INFO) << "Embedding names: " << embedding_names;
   LOG(INFO) << "Embedding dims: " << embedding_dims;
   embedding_fml_ = utils::Split(features, ';');
-  add_strings_ = context->Get(GetParamName("add_varlen_strings"), true);
   embedding_names_ = utils::Split(embedding_names, ';');
   for (const string &dim : utils::Split(embedding_dims, ';')) {
     embedding_dims_.push_back(utils::ParseUsing<int>(dim, utils::ParseInt32));
@@ -17,33 +18,58 @@ void GenericEmbeddingFeatureExtractor::Setup(TaskContext *context) {
 }
 
 void GenericEmbeddingFeatureExtractor::Init(TaskContext *context) {
+  // Resolve the continuous feature types once, instead of matching their
+  // names for every extracted feature.
+  continuous_.resize(embedding_fml_.size());
+  for (size_t i = 0; i < embedding_fml_.size(); ++i) {
+    const GenericFeatureExtractor &extractor = generic_feature_extractor(i);
+    continuous_[i].resize(extractor.feature_types());
+    for (int j = 0; j < extractor.feature_types(); ++j) {
+      const FeatureType *feature_type = extractor.feature_type(j);
+      continuous_[i][feature_type->base()] =
+        feature_type->name().find("continuous") == 0;
+    }
+  }
 }
 
-vector<vector<SparseFeatures>> GenericEmbeddingFeatureExtractor::ConvertExample(
-    const vector<FeatureVector> &feature_vectors) const {
-  // Extract the features.
-  vector<vector<SparseFeatures>> sparse_features(feature_vectors.size());
+void GenericEmbeddingFeatureExtractor::ConvertExample(
+    const vector<FeatureVector> &feature_vectors,
+    vector<FeatureIds> *feature_ids) const {
+  feature_ids->resize(feature_vectors.size());
   for (size_t i = 0; i < feature_vectors.size(); ++i) {
-    sparse_features[i] = 
-      vector<SparseFeatures>(generic_feature_extractor(i).feature_types());
+    FeatureIds &ids = (*feature_ids)[i];
+    ids.Reset(generic_feature_extractor(i).feature_types());
 
     for (int j = 0; j < feature_vectors[i].size(); ++j) {
       const FeatureType &feature_type = *feature_vectors[i].type(j);
       const FeatureValue value = feature_vectors[i].value(j);
-      const bool is_continuous = feature_type.name().find("continuous") == 0;
-      const int64_t id = is_continuous ? FloatFeatureValue(value).id : value;
       const int base = feature_type.base();
+      const bool is_continuous = continuous_[i][base];
+      const int64_t id = is_continuous ? FloatFeatureValue(value).id : value;
       if (id >= 0) {
-        sparse_features[i][base].add_id(id);
+        ids.set_id(base, id);
         if (is_continuous) {
-          sparse_features[i][base].add_weight(FloatFeatureValue(value).weight);
-        }
-        if (add_strings_) {
-          sparse_features[i][base].add_description(feature_type.name() + "=" + feature_type.GetFeatureValueName(id));
+          ids.set_weight(base, FloatFeatureValue(value).weight);
         }
       }
     }
   }
-  
-  return sparse_features;
+}
+
+string GenericEmbeddingFeatureExtractor::FeatureDescription(
+    int idx, int slot, int32_t id) const {
+  const FeatureType &feature_type =
+    *generic_feature_extractor(idx).feature_type(slot);
+  if (id == FeatureIds::kNoFeature) return feature_type.name() + "=<NONE>";
+  return feature_type.name() + "=" + feature_type.GetFeatureValueName(id);
+}
+
+vector<string> GenericEmbeddingFeatureExtractor::FeatureDescriptions(
+    int idx, const int32_t *ids, int size) const {
+  CHECK_EQ(size, generic_feature_extractor(idx).feature_types());
+  vector<string> descriptions(size);
+  for (int slot = 0; slot < size; ++slot) {
+    descriptions[slot] = FeatureDescription(idx, slot, ids[slot]);
+  }
+  return descriptions;
 }
@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 
+#include "compiled_parser_features.h"
 #include "feature_extractor.h"
 #include "feature_types.h"
 #include "parser_features.h"
@@ -66,6 +67,22 @@ class GenericEmbeddingFeatureExtractor {
       return ArgPrefix() + "_" + param_name;
     }
 
+    /*!
+     * \brief Renders "<feature type>=<value name>" for the id in the given slot
+     * of the feature extractor at index idx. This is a debugging/introspection
+     * API; feature extraction itself never produces strings.
+     */
+    string FeatureDescription(int idx, int slot, int32_t id) const;
+
+    // Renders descriptions for all slots of an id vector of the feature
+    // extractor at index idx, e.g. a FeatureIds::data() or an exported row.
+    vector<string> FeatureDescriptions(int idx, const int32_t *ids,
+        int size) const;
+
+    vector<string> FeatureDescriptions(int idx, const FeatureIds &ids) const {
+      return FeatureDescriptions(idx, ids.data(), ids.size());
+    }
+
   protected:
     /*!
      * \brief Provides the generic class with access to the templated extractors.
@@ -75,13 +92,12 @@ class GenericEmbeddingFeatureExtractor {
     virtual const GenericFeatureExtractor &generic_feature_extractor(int idx) const = 0;
 
     /*!
-     * \brief Converts a vector of extracted features into dist_belief::SparseFeatures.
-     * Each feature in each feature vector becomes a single SparseFeatures. The predicates
-     * are mapped through map_fn which should point to either mutable_map_fn or const_map_fn
-     * depending on whether or not the predicate maps should be updated.
+     * \brief Converts a vector of extracted features into compact FeatureIds, one
+     * per feature extractor. Each feature lands in the slot of its feature type;
+     * the storage of the output objects is reused.
      */
-    vector<vector<SparseFeatures>> ConvertExample(
-        const vector<FeatureVector> &feature_vectors) const;
+    void ConvertExample(const vector<FeatureVector> &feature_vectors,
+        vector<FeatureIds> *feature_ids) const;
 
   private:
     // Embedding space names for parameter sharing.
@@ -96,8 +112,9 @@ class GenericEmbeddingFeatureExtractor {
     // Embedding dimensions of the embedding spaces (i.e. 32, 64 etc.)
     vector<int> embedding_dims_;
 
-    // Wheter or not to add string descriptions to converted examples.
-    bool add_strings_;
+    // Whether the feature type in a slot is continuous, indexed as
+    // continuous_[extractor][base]. Computed in Init().
+    vector<vector<bool>> continuous_;
 };
 
 /*!
@@ -123,10 +140,10 @@ class EmbeddingFeatureExtractor : public GenericEmbeddingFeatureExtractor {
 
     // Initializes resources needed by the feature extractors.
     void Init(TaskContext *context) override {
-      GenericEmbeddingFeatureExtractor::Init(context);
       for (auto &feature_extractor : feature_extractors_) {
           feature_extractor.Init(context);
       }
+      GenericEmbeddingFeatureExtractor::Init(context);
     }
 
     // Requests workspaces from the registry. Must be called after Init(),
@@ -146,17 +163,29 @@ class EmbeddingFeatureExtractor : public GenericEmbeddingFeatureExtractor {
     }
 
     /*!
-     * \brief Returns a ragged array of SparseFeatures.
-     * for 1) each feature extractor class e, and 2) each feature f extracted by e.
-     * Underlying predicate maps will not be updated and so unrecognized predicates may
-     * occur. In such a case the SparseFeatures object associated with a given
-     * extractor class and feature will be empty.
+     * \brief Returns one FeatureIds for each feature extractor class e, holding
+     * the id of each feature f extracted by e. Underlying predicate maps will not
+     * be updated and so unrecognized predicates may occur. In such a case the
+     * slot associated with a given extractor class and feature is kNoFeature.
      */
-    vector<vector<SparseFeatures>> ExtractSparseFeatures(
+    vector<FeatureIds> ExtractSparseFeatures(
         const WorkspaceSet &workspaces, const OBJ &obj, ARGS... args) const {
       vector<FeatureVector> features(feature_extractors_.size());
-      ExtractFeatures(workspaces, obj, args..., &features);
-      return ConvertExample(features);
+      vector<FeatureIds> feature_ids;
+      ExtractSparseFeatures(workspaces, obj, args..., &features, &feature_ids);
+      return feature_ids;
+    }
+
+    /*!
+     * \brief Like above, but reuses the caller's buffers so that steady-state
+     * extraction does not allocate. features must already be sized to the
+     * number of feature extractors.
+     */
+    void ExtractSparseFeatures(const WorkspaceSet &workspaces, const OBJ &obj,
+        ARGS... args, vector<FeatureVector> *features,
+        vector<FeatureIds> *feature_ids) const {
+      ExtractFeatures(workspaces, obj, args..., features);
+      ConvertExample(*features, feature_ids);
     }
 
     /*!
@@ -195,11 +224,49 @@ class ParserEmbeddingFeatureExtractor
     explicit ParserEmbeddingFeatureExtractor(const string &arg_prefix)
       : arg_prefix_(arg_prefix) {}
 
+    // Also initializes the compiled feature extractor, which is used if it was
+    // built from the same spec and "<prefix>_use_compiled_features" is true.
+    void Init(TaskContext *context) override {
+      EmbeddingFeatureExtractor::Init(context);
+      use_compiled_ =
+          context->Get(GetParamName("use_compiled_features"), true) &&
+          compiled_.Init(context, embedding_fml());
+      if (use_compiled_) LOG(INFO) << "Using compiled parser features.";
+    }
+
+    void RequestWorkspaces(WorkspaceRegistry *registry) override {
+      EmbeddingFeatureExtractor::RequestWorkspaces(registry);
+      if (use_compiled_) compiled_.RequestWorkspaces(registry);
+    }
+
+    /*!
+     * \brief Same result as ExtractSparseFeatures(), but uses the compiled
+     * feature extractor when available, in which case feature_vectors is left
+     * untouched. The state must have been preprocessed.
+     */
+    void ExtractFeatureIds(const WorkspaceSet &workspaces,
+        const ParserState &state, vector<FeatureVector> *feature_vectors,
+        vector<FeatureIds> *feature_ids) const {
+      if (use_compiled_) {
+        compiled_.Extract(workspaces, state, feature_ids);
+      } else {
+        ExtractSparseFeatures(workspaces, state, feature_vectors, feature_ids);
+      }
+    }
+
+    bool use_compiled() const { return use_compiled_; }
+
   private:
     const string ArgPrefix() const override { return arg_prefix_; }
 
     // Prefix for context parameters.
     string arg_prefix_;
+
+    // Extractor compiled from a fixed FML spec, see compiled_parser_features.h.
+    CompiledParserFeatures compiled_;
+
+    // Whether compiled_ matches the spec and is used for extraction.
+    bool use_compiled_ = false;
 };
 
 #endif
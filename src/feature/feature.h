@@ -86,6 +86,11 @@ public:
         CHECK_LT(index, feature_.size());
         return feature_[index];
     }
+    const FeatureFunctionDescriptor &feature(int index) const {
+        CHECK_GE(index, 0);
+        CHECK_LT(index, feature_.size());
+        return *feature_[index];
+    }
 };
 
 
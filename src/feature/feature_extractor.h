@@ -41,6 +41,10 @@ void ToFMLFunction(const FeatureFunctionDescriptor &function, string *output);
 
 void ToFML(const FeatureFunctionDescriptor &function, string *output);
 
+// Output all top level features of an extractor, separated by spaces. Specs
+// that only differ in whitespace give the same output.
+void ToFML(const FeatureExtractorDescriptor &extractor, string *output);
+
 /*!
  * \brief A feature vector contains feature type and value pairs.
  */
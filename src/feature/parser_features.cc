@@ -150,6 +150,12 @@ REGISTER_PARSER_IDX_FEATURE_FUNCTION("tag", TagFeatureFunction);
 typedef BasicParserSentenceFeatureFunction<Digit> DigitFeatureFunction;
 REGISTER_PARSER_IDX_FEATURE_FUNCTION("digit", DigitFeatureFunction);
 
+typedef BasicParserSentenceFeatureFunction<PrefixFeature> PrefixFeatureFunction;
+REGISTER_PARSER_IDX_FEATURE_FUNCTION("prefix", PrefixFeatureFunction);
+
+typedef BasicParserSentenceFeatureFunction<SuffixFeature> SuffixFeatureFunction;
+REGISTER_PARSER_IDX_FEATURE_FUNCTION("suffix", SuffixFeatureFunction);
+
 
 // Parser feature function that can use nested sentence feature functions for
 // feature extraction.
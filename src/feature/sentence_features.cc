@@ -47,9 +47,9 @@ string Hyphen::GetFeatureValueName(FeatureValue value) const {
 }
 
 FeatureValue Hyphen::ComputeValue(const Token &token) const {
-  const string &word = token.word();
-  // bug? if no '-', find function will return -1
-  return (word.find('-') < word.length() ? HAS_HYPHEN : NO_HYPHEN);
+  const StringPiece word = token.word();
+  return !word.empty() && memchr(word.data(), '-', word.size()) != nullptr
+             ? HAS_HYPHEN : NO_HYPHEN;
 }
 
 // Registry for the Sentence + token index feature functions.
@@ -63,7 +63,62 @@ FeatureValue Digit::ComputeValue(const Token &token) const {
     return 0;
 }
 
+AffixTableFeature::AffixTableFeature(AffixTable::Type type)
+  : type_(type) {
+  input_name_ = type == AffixTable::PREFIX ? "prefix-table" : "suffix-table";
+}
+
+AffixTableFeature::~AffixTableFeature() {
+  if (affix_table_ != nullptr) {
+    SharedStore::Release(affix_table_);
+    affix_table_ = nullptr;
+  }
+}
+
+void AffixTableFeature::Setup(TaskContext *context) {
+  context->GetInput(input_name_, "text", "affix-table");
+  affix_length_ = GetIntParameter("length", 0);
+  CHECK_GT(affix_length_, 0)
+      << "Affix length must be specified, e.g. " << input_name_
+      << "(length=3).";
+}
+
+void AffixTableFeature::Init(TaskContext *context) {
+  const string file_name = context->InputFile(*context->GetInput(input_name_));
+  affix_table_ = SharedStoreUtils::GetWithDefaultName<AffixTable>(file_name);
+  CHECK_EQ(affix_table_->type(), type_)
+      << file_name << " does not hold the expected kind of affixes.";
+  CHECK_LE(affix_length_, affix_table_->max_length())
+      << "Affix length exceeds the maximum length of " << file_name << ".";
+  TokenLookupFeature::Init(context);
+}
+
+string AffixTableFeature::WorkspaceName() const {
+  const string prefix = "affix-table";
+  const int type = type_;
+  return SharedStoreUtils::CreateDefaultName(prefix, input_name_, type,
+                                             affix_length_);
+}
+
+FeatureValue AffixTableFeature::ComputeValue(const Token &token) const {
+  const StringPiece word = token.word();
+  const int id =
+      affix_table_->AffixIdForWord(word.data(), word.size(), affix_length_);
+  return id < 0 ? UnknownValue() : id;
+}
+
+string AffixTableFeature::GetFeatureValueName(FeatureValue value) const {
+  if (value == UnknownValue()) return "<UNKNOWN>";
+  if (value >= 0 && value < UnknownValue()) {
+    return affix_table_->AffixForm(value);
+  }
+  LOG(ERROR) << "Invalid feature value: " << value;
+  return "<INVALID>";
+}
+
 // Register the features defined in the header.
 REGISTER_SENTENCE_IDX_FEATURE("word", Word);
 REGISTER_SENTENCE_IDX_FEATURE("lcword", LowercaseWord);
 REGISTER_SENTENCE_IDX_FEATURE("tag", Tag);
+REGISTER_SENTENCE_IDX_FEATURE("prefix", PrefixFeature);
+REGISTER_SENTENCE_IDX_FEATURE("suffix", SuffixFeature);
@@ -115,8 +115,8 @@ class Word : public TermFrequencyMapFeature {
     Word() : TermFrequencyMapFeature("word-map") {}
 
     FeatureValue ComputeValue(const Token &token) const override {
-      string form = token.word();
-      return term_map().LookupIndex(form, UnknownValue());
+      return term_map().LookupIndex(token.word(), token.word_id(),
+                                    UnknownValue());
     }
 };
 
@@ -125,9 +125,21 @@ class LowercaseWord : public TermFrequencyMapFeature {
     LowercaseWord() : TermFrequencyMapFeature("lc-word-map") {}
 
     FeatureValue ComputeValue(const Token &token) const override {
-      const string lcword = utils::Lowercase(token.word());
-      return term_map().LookupIndex(lcword, UnknownValue());
+      // Lowercase short words into a stack buffer to avoid an allocation.
+      const StringPiece word = token.word();
+      char buffer[kMaxBufferedWordSize];
+      if (word.size() > sizeof(buffer)) {
+        return term_map().LookupIndex(utils::Lowercase(word.ToString()),
+                                      UnknownValue());
+      }
+      for (size_t i = 0; i < word.size(); ++i) buffer[i] = tolower(word[i]);
+      return term_map().LookupIndex(StringPiece(buffer, word.size()),
+                                    UnknownValue());
     }
+
+  private:
+    // Longest word in bytes that is lowercased without allocating.
+    static const int kMaxBufferedWordSize = 64;
 };
 
 class Tag : public TermFrequencyMapFeature {
@@ -135,7 +147,8 @@ class Tag : public TermFrequencyMapFeature {
     Tag() : TermFrequencyMapFeature("tag-map") {}
 
     FeatureValue ComputeValue(const Token &token) const override {
-      return term_map().LookupIndex(token.tag(), UnknownValue());
+      return term_map().LookupIndex(token.tag(), token.tag_id(),
+                                    UnknownValue());
     }
 };
 
@@ -144,7 +157,8 @@ class Label : public TermFrequencyMapFeature {
     Label() : TermFrequencyMapFeature("label-map") {}
 
     FeatureValue ComputeValue(const Token &token) const override {
-      return term_map().LookupIndex(token.label(), UnknownValue());
+      return term_map().LookupIndex(token.label(), token.label_id(),
+                                    UnknownValue());
     }
 };
 
@@ -221,6 +235,25 @@ class AffixTableFeature : public TokenLookupFeature {
     // Requests inputs for the affix table.
     void Setup(TaskContext *context) override;
 
+    // Loads the affix table from the SharedStore.
+    void Init(TaskContext *context) override;
+
+    // The workspace name is specific to which affix length we are computing.
+    string WorkspaceName() const override;
+
+    // Returns the total number of affixes in the table, plus one for the
+    // unknown affix.
+    int64_t NumValues() const override { return affix_table_->size() + 1; }
+
+    // Special value for affixes not in the table and words that are too short.
+    FeatureValue UnknownValue() const { return affix_table_->size(); }
+
+    // Returns the affix id of the token's word, or UnknownValue().
+    FeatureValue ComputeValue(const Token &token) const override;
+
+    // Returns the affix form, or <UNKNOWN>.
+    string GetFeatureValueName(FeatureValue value) const override;
+
   private:
     // Size parameter for the affix table.
     int affix_length_;
@@ -4,31 +4,61 @@
 #include "../utils/utils.h"
 
 /*!
- * \brief A sparse set of features.
- * If using SparseStringToIdTransformer, description is required and id
- * should be omitted; otherwise, id is required and description optional.
+ * \brief Compact feature ids of one embedding space (one feature group).
+ * There is exactly one slot per feature type of the group, addressed by
+ * FeatureType::base(), which holds a 32-bit id or kNoFeature if the feature
+ * did not fire. Only single-valued feature functions are supported.
  *
- * id, weight, and description fields are all algined if present (i.e., any
- * of these that are non-empty should have the same # items). If weight is
- * omitted, 1.0 is used.
+ * Weights live in a side array that is allocated only once a weight is set
+ * (i.e. for groups with continuous features); otherwise every id has an
+ * implicit weight of 1.0. Human readable descriptions are not stored; use
+ * GenericEmbeddingFeatureExtractor::FeatureDescriptions() to render them.
  */
-class SparseFeatures {
+class FeatureIds {
 public:
-    std::vector<uint64_t> id_;
-    std::vector<float> weight_;
-    std::vector<std::string> description_;
+    // Id of a slot whose feature did not fire.
+    static constexpr int32_t kNoFeature = -1;
 
-    void add_id(uint64_t id) {
-        id_.push_back(id);
+    // Resizes to the given number of slots and clears them, keeping the
+    // allocated storage so the object can be reused across states.
+    void Reset(int size) {
+        ids_.assign(size, kNoFeature);
+        weights_.clear();
     }
 
-    void add_weight(float weight) {
-        weight_.push_back(weight);
+    int size() const { return ids_.size(); }
+
+    int32_t id(int slot) const { return ids_[slot]; }
+
+    void set_id(int slot, int32_t id) {
+        DCHECK_EQ(ids_[slot], kNoFeature)
+            << "Multi-valued features are not supported.";
+        ids_[slot] = id;
     }
 
-    void add_description(const string &description) {
-        description_.push_back(description);
+    // Raw id array, size() elements.
+    const int32_t *data() const { return ids_.data(); }
+
+    // Writable id array for extractors that fill all slots at once.
+    int32_t *mutable_data() { return ids_.data(); }
+
+    bool has_weights() const { return !weights_.empty(); }
+
+    float weight(int slot) const {
+        return weights_.empty() ? 1.0f : weights_[slot];
     }
 
+    void set_weight(int slot, float weight) {
+        if (weights_.empty()) weights_.assign(ids_.size(), 1.0f);
+        weights_[slot] = weight;
+    }
+
+private:
+    // One id per feature type.
+    vector<int32_t> ids_;
+
+    // Optional weights, aligned with ids_ if present.
+    vector<float> weights_;
 };
+
 #endif //SYNTAXNET_SPARSE_FEATURES_H
@@ -0,0 +1,200 @@
+/*!
+ * \brief Generates a compile-time specialized parser feature extractor from an
+ * FML spec (see feature/compiled_parser_features.h).
+ *
+ * Usage: fml_codegen <spec file> <output header>
+ *
+ * The spec file holds the value of the "<prefix>_features" parameter, i.e.
+ * one FML feature group per embedding space separated by ';'. Only the
+ * parser locators input, stack, head, child and sibling and the word, tag and
+ * label features without parameters are supported; anything else is an error
+ * so that a spec is never compiled into something that extracts differently.
+ */
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "fml_parser.h"
+#include "../feature/feature_extractor.h"
+
+namespace {
+
+// Reports an unsupported feature and exits.
+void Unsupported(const FeatureFunctionDescriptor &function,
+                 const string &reason) {
+    string fml;
+    ToFML(function, &fml);
+    std::cerr << "fml_codegen: cannot compile \"" << fml << "\": " << reason
+              << std::endl;
+    exit(1);
+}
+
+// Collected output for one feature group.
+struct GroupCode {
+    // Feature types in extraction order.
+    vector<string> features;
+
+    // FML of each feature, for comments.
+    vector<string> names;
+};
+
+// Which term maps the spec uses.
+struct Uses {
+    bool words = false;
+    bool tags = false;
+    bool labels = false;
+};
+
+// Appends the features below an index locator (or the top level locator)
+// whose type is locator, in the order the generic extractor evaluates them.
+void AddNestedFeatures(const FeatureFunctionDescriptor &function,
+                       const string &locator, const string &path,
+                       GroupCode *group, Uses *uses) {
+    if (function.feature_size() == 0) {
+        Unsupported(function, "locator without nested feature");
+    }
+    for (int i = 0; i < function.feature_size(); ++i) {
+        const FeatureFunctionDescriptor &nested = function.feature(i);
+        const string &type = nested.type();
+        if (nested.parameter_size() > 0) {
+            Unsupported(nested, "parameters are not supported");
+        }
+        string fml;
+        ToFMLFunction(nested, &fml);
+        const string nested_path = path + "." + fml;
+        const string argument = utils::Printf(nested.argument());
+        if (type == "head" || type == "child" || type == "sibling") {
+            string name = type == "head" ? "Head" :
+                          type == "child" ? "Child" : "Sibling";
+            AddNestedFeatures(nested, name + "<" + locator + ", " + argument + ">",
+                              nested_path, group, uses);
+        } else if (type == "word" || type == "tag" || type == "label") {
+            if (nested.feature_size() > 0) {
+                Unsupported(nested, "nested features below a value feature");
+            }
+            if (nested.argument() != 0) {
+                Unsupported(nested, "value features take no argument");
+            }
+            string name;
+            if (type == "word") {
+                name = "Word";
+                uses->words = true;
+            } else if (type == "tag") {
+                name = "Tag";
+                uses->tags = true;
+            } else {
+                name = "Label";
+                uses->labels = true;
+            }
+            group->features.push_back(name + "<" + locator + ">");
+            group->names.push_back(nested_path);
+        } else {
+            Unsupported(nested, "unknown feature type");
+        }
+    }
+}
+
+// Escapes a string for a C++ string literal.
+string Escape(const string &text) {
+    string output;
+    for (char c : text) {
+        if (c == '"' || c == '\\') output.push_back('\\');
+        output.push_back(c);
+    }
+    return output;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        std::cerr << "Usage: fml_codegen <spec file> <output header>" << std::endl;
+        return 1;
+    }
+
+    std::ifstream spec_file(argv[1]);
+    if (!spec_file) {
+        std::cerr << "fml_codegen: cannot read " << argv[1] << std::endl;
+        return 1;
+    }
+    std::stringstream buffer;
+    buffer << spec_file.rdbuf();
+
+    vector<GroupCode> groups;
+    vector<string> canonical;
+    Uses uses;
+    for (const string &fml : utils::Split(buffer.str(), ';')) {
+        FeatureExtractorDescriptor descriptor;
+        FMLParser parser;
+        parser.Parse(fml, &descriptor);
+        string group_fml;
+        ToFML(descriptor, &group_fml);
+        canonical.push_back(group_fml);
+
+        GroupCode group;
+        for (int i = 0; i < descriptor.feature_size(); ++i) {
+            const FeatureFunctionDescriptor &function = descriptor.feature(i);
+            if (function.parameter_size() > 0) {
+                Unsupported(function, "parameters are not supported");
+            }
+            string locator;
+            if (function.type() == "input") {
+                locator = "Input<";
+            } else if (function.type() == "stack") {
+                locator = "Stack<";
+            } else {
+                Unsupported(function, "top level feature must be input or stack");
+            }
+            locator += utils::Printf(function.argument()) + ">";
+            string path;
+            ToFMLFunction(function, &path);
+            AddNestedFeatures(function, locator, path, &group, &uses);
+        }
+        groups.push_back(group);
+    }
+
+    std::ostringstream out;
+    out << "// Generated by fml_codegen from " << argv[1] << ". Do not edit.\n"
+        << "#ifndef COMPILED_PARSER_FEATURES_SPEC_H_\n"
+        << "#define COMPILED_PARSER_FEATURES_SPEC_H_\n\n"
+        << "// Included by feature/compiled_parser_features.cc.\n\n"
+        << "namespace compiled_parser_features {\n\n"
+        << "// Canonical FML of the compiled spec, groups separated by ';'.\n"
+        << "const char kCompiledSpec[] =\n    \""
+        << Escape(utils::Join(canonical, ";")) << "\";\n\n"
+        << "const bool kUsesWords = " << (uses.words ? "true" : "false") << ";\n"
+        << "const bool kUsesTags = " << (uses.tags ? "true" : "false") << ";\n"
+        << "const bool kUsesLabels = " << (uses.labels ? "true" : "false")
+        << ";\n\n";
+    for (size_t g = 0; g < groups.size(); ++g) {
+        out << "typedef Group<\n";
+        const GroupCode &group = groups[g];
+        for (size_t i = 0; i < group.features.size(); ++i) {
+            out << "    " << group.features[i]
+                << (i + 1 < group.features.size() ? "," : "")
+                << "  // " << group.names[i] << "\n";
+        }
+        out << "> Group" << g << ";\n\n";
+    }
+    out << "const int kNumGroups = " << groups.size() << ";\n\n"
+        << "const int kGroupSizes[] = {";
+    for (size_t g = 0; g < groups.size(); ++g) {
+        out << (g > 0 ? ", " : "") << "Group" << g << "::kSize";
+    }
+    out << "};\n\n"
+        << "const ExtractFunction kExtractFunctions[] = {";
+    for (size_t g = 0; g < groups.size(); ++g) {
+        out << (g > 0 ? ", " : "") << "&Group" << g << "::Extract";
+    }
+    out << "};\n\n"
+        << "}  // namespace compiled_parser_features\n\n"
+        << "#endif\n";
+
+    std::ofstream output(argv[2]);
+    output << out.str();
+    if (!output) {
+        std::cerr << "fml_codegen: cannot write " << argv[2] << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -238,3 +238,10 @@ void ToFML(const FeatureFunctionDescriptor &function, string *output) {
         output->append(" } ");
     }
 }
+
+void ToFML(const FeatureExtractorDescriptor &extractor, string *output) {
+    for (int i = 0; i < extractor.feature_size(); ++i) {
+        if (i > 0) output->append(" ");
+        ToFML(extractor.feature(i), output);
+    }
+}
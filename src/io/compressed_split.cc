@@ -0,0 +1,127 @@
+#include "compressed_split.h"
+
+#include <string.h>
+
+#include "../../dmlc-core/src/io/filesys.h"
+#include "../utils/utils.h"
+#include "compression.h"
+
+namespace {
+
+// Initial size of the buffer, which grows for longer records.
+const size_t kDefaultChunkSize = 1 << 22;
+
+}  // namespace
+
+CompressedSplit::CompressedSplit(const string &uri, unsigned part_index,
+                                 unsigned num_parts,
+                                 RecordBoundary find_last_record_begin)
+    : find_last_record_begin_(find_last_record_begin),
+      buffer_(kDefaultChunkSize) {
+    for (const string &file : utils::Split(uri, ';')) {
+        if (file.empty()) continue;
+        dmlc::io::URI path(file.c_str());
+        const dmlc::io::FileInfo info =
+            dmlc::io::FileSystem::GetInstance(path)->GetPathInfo(path);
+        CHECK(info.type == dmlc::io::kFile) << file << " is not a file.";
+        files_.push_back(file);
+        file_sizes_.push_back(info.size);
+    }
+    ResetPartition(part_index, num_parts);
+}
+
+bool CompressedSplit::HasCompressedFile(const string &uri) {
+    for (const string &file : utils::Split(uri, ';')) {
+        if (!file.empty() && FileCompression(file) != kNoCompression) return true;
+    }
+    return false;
+}
+
+void CompressedSplit::HintChunkSize(size_t chunk_size) {
+    if (chunk_size > buffer_.size() && stream_ == nullptr) buffer_.resize(chunk_size);
+}
+
+void CompressedSplit::ResetPartition(unsigned part_index, unsigned num_parts) {
+    CHECK_LT(part_index, num_parts) << "Bad part " << part_index << " of "
+                                    << num_parts;
+    size_t total_size = 0;
+    for (size_t size : file_sizes_) total_size += size;
+
+    // File i starts in part offset * num_parts / total_size.
+    auto Part = [&](size_t offset) {
+        return total_size == 0 ? 0 : static_cast<unsigned>(
+            static_cast<double>(offset) * num_parts / total_size);
+    };
+    file_begin_ = files_.size();
+    file_end_ = files_.size();
+    size_t offset = 0;
+    for (size_t i = 0; i < files_.size(); ++i) {
+        const unsigned part = Part(offset);
+        if (part == part_index && file_begin_ == files_.size()) file_begin_ = i;
+        if (part > part_index) {
+            file_end_ = i;
+            break;
+        }
+        offset += file_sizes_[i];
+    }
+    if (file_begin_ > file_end_) file_begin_ = file_end_;
+    BeforeFirst();
+}
+
+void CompressedSplit::BeforeFirst() {
+    stream_.reset();
+    next_file_ = file_begin_;
+    data_begin_ = 0;
+    data_end_ = 0;
+}
+
+bool CompressedSplit::NextRecord(Blob *out_rec) {
+    LOG(FATAL) << "CompressedSplit only reads chunks.";
+    return false;
+}
+
+bool CompressedSplit::NextChunk(Blob *out_chunk) {
+    while (true) {
+        if (stream_ == nullptr) {
+            if (next_file_ == file_end_) return false;
+            stream_.reset(OpenDecompressingInput(files_[next_file_++]));
+            data_begin_ = 0;
+            data_end_ = 0;
+        }
+
+        // Move the rest of the last chunk to the front, and make room if it
+        // fills the buffer because no record begins in it.
+        const size_t rest = data_end_ - data_begin_;
+        if (data_begin_ > 0) memmove(buffer_.data(), buffer_.data() + data_begin_, rest);
+        if (rest == buffer_.size()) buffer_.resize(2 * buffer_.size());
+        data_begin_ = 0;
+        data_end_ = rest;
+
+        bool at_end = false;
+        while (data_end_ < buffer_.size()) {
+            const size_t size = stream_->Read(buffer_.data() + data_end_,
+                                              buffer_.size() - data_end_);
+            if (size == 0) {
+                at_end = true;
+                break;
+            }
+            data_end_ += size;
+        }
+
+        char *begin = buffer_.data();
+        const char *end = begin + data_end_;
+        if (at_end) {
+            // The rest of the file is the last chunk of it.
+            stream_.reset();
+            data_begin_ = data_end_;
+            if (end == begin) continue;
+        } else {
+            end = find_last_record_begin_(begin, end);
+            if (end == begin) continue;
+            data_begin_ = end - begin;
+        }
+        out_chunk->dptr = begin;
+        out_chunk->size = end - begin;
+        return true;
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef SYNTAXNET_COMPRESSED_SPLIT_H
+#define SYNTAXNET_COMPRESSED_SPLIT_H
+
+#include <memory>
+
+#include "../../dmlc-core/include/dmlc/io.h"
+
+#include "../base.h"
+
+/*!
+ * \brief Input split over corpora with gzip or zstd compressed files.
+ *
+ * Compressed files cannot be cut at arbitrary bytes, so the files are the
+ * unit of sharding: a file belongs to the part that its first byte falls
+ * into when the files are cut into num_parts byte ranges of about the same
+ * size, like dmlc's splits cut them. Corpora that are read in many parts
+ * should thus be stored in at least as many files. Files that are not
+ * compressed are read as they are.
+ *
+ * The files are decompressed as the chunks are read, i.e. in the thread
+ * that reads them, which is the prefetch thread of a prefetching
+ * TextReader. Chunks hold whole records of a single file: they are cut
+ * after the last record that begins in the decompressed data, as found by
+ * the format's find_last_record_begin, and at the end of each file.
+ */
+class CompressedSplit : public dmlc::InputSplit {
+public:
+    // Returns the beginning of the last record that begins in [begin, end),
+    // or begin if there is none after it.
+    typedef const char *(*RecordBoundary)(const char *begin, const char *end);
+
+    // Splits the files of uri, a list of paths separated by ';', and
+    // positions the splitter at the beginning of the part_index'th of
+    // num_parts parts.
+    CompressedSplit(const string &uri, unsigned part_index, unsigned num_parts,
+                    RecordBoundary find_last_record_begin);
+
+    // Returns whether any file in uri is compressed.
+    static bool HasCompressedFile(const string &uri);
+
+    void HintChunkSize(size_t chunk_size) override;
+
+    void BeforeFirst() override;
+
+    // Not supported: the document format cuts the chunks into records.
+    bool NextRecord(Blob *out_rec) override;
+
+    bool NextChunk(Blob *out_chunk) override;
+
+    void ResetPartition(unsigned part_index, unsigned num_parts) override;
+
+private:
+    RecordBoundary find_last_record_begin_;
+
+    // All files and their (compressed) sizes.
+    vector<string> files_;
+    vector<size_t> file_sizes_;
+
+    // Files [file_begin_, file_end_) make up the current part, and
+    // next_file_ is the next one to open.
+    size_t file_begin_ = 0;
+    size_t file_end_ = 0;
+    size_t next_file_ = 0;
+
+    // Decompressed stream of the file being read, or null.
+    std::unique_ptr<dmlc::Stream> stream_;
+
+    // Decompressed data. [data_begin_, data_end_) has been read from the
+    // stream but not returned in a chunk yet.
+    vector<char> buffer_;
+    size_t data_begin_ = 0;
+    size_t data_end_ = 0;
+};
+
+#endif //SYNTAXNET_COMPRESSED_SPLIT_H
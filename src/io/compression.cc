@@ -0,0 +1,289 @@
+#include "compression.h"
+
+#include <string.h>
+#include <zlib.h>
+
+#include <memory>
+
+#ifdef SYNTAXNET_USE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+// Size of the buffers of compressed data.
+const size_t kBufferSize = 1 << 18;
+
+const unsigned char kGzipMagic[] = {0x1f, 0x8b};
+const unsigned char kZstdMagic[] = {0x28, 0xb5, 0x2f, 0xfd};
+
+bool HasSuffix(const string &text, const string &suffix) {
+    return text.size() >= suffix.size() &&
+           text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Reads up to size bytes, fewer only at the end of the stream.
+size_t ReadFully(dmlc::Stream *stream, char *data, size_t size) {
+    size_t num_read = 0;
+    while (num_read < size) {
+        const size_t n = stream->Read(data + num_read, size - num_read);
+        if (n == 0) break;
+        num_read += n;
+    }
+    return num_read;
+}
+
+// Base of the streams that only read or only write.
+class InputStream : public dmlc::Stream {
+public:
+    void Write(const void *ptr, size_t size) override {
+        LOG(FATAL) << "Cannot write to a decompressing stream.";
+    }
+};
+
+class OutputStream : public dmlc::Stream {
+public:
+    size_t Read(void *ptr, size_t size) override {
+        LOG(FATAL) << "Cannot read from a compressing stream.";
+        return 0;
+    }
+};
+
+class GzipInputStream : public InputStream {
+public:
+    explicit GzipInputStream(dmlc::Stream *stream)
+        : stream_(stream), input_(kBufferSize) {
+        memset(&zstream_, 0, sizeof(zstream_));
+        // Only accept gzip headers.
+        CHECK_EQ(inflateInit2(&zstream_, 15 + 16), Z_OK);
+    }
+
+    ~GzipInputStream() { inflateEnd(&zstream_); }
+
+    size_t Read(void *ptr, size_t size) override {
+        zstream_.next_out = static_cast<Bytef *>(ptr);
+        zstream_.avail_out = static_cast<uInt>(size);
+        while (zstream_.avail_out > 0) {
+            if (zstream_.avail_in == 0) {
+                zstream_.avail_in = static_cast<uInt>(
+                    stream_->Read(input_.data(), input_.size()));
+                zstream_.next_in = reinterpret_cast<Bytef *>(input_.data());
+                if (zstream_.avail_in == 0) {
+                    CHECK(!in_member_) << "Truncated gzip file.";
+                    break;
+                }
+            }
+            const int status = inflate(&zstream_, Z_NO_FLUSH);
+            if (status == Z_STREAM_END) {
+                // Files may hold several gzip members, e.g. from cat.
+                CHECK_EQ(inflateReset(&zstream_), Z_OK);
+                in_member_ = false;
+            } else {
+                CHECK_EQ(status, Z_OK) << "Bad gzip data: "
+                                       << (zstream_.msg ? zstream_.msg : "");
+                in_member_ = true;
+            }
+        }
+        return size - zstream_.avail_out;
+    }
+
+private:
+    std::unique_ptr<dmlc::Stream> stream_;
+    vector<char> input_;
+    z_stream zstream_;
+
+    // Whether the data read so far ends inside a gzip member.
+    bool in_member_ = false;
+};
+
+class GzipOutputStream : public OutputStream {
+public:
+    explicit GzipOutputStream(dmlc::Stream *stream)
+        : stream_(stream), output_(kBufferSize) {
+        memset(&zstream_, 0, sizeof(zstream_));
+        CHECK_EQ(deflateInit2(&zstream_, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                              15 + 16, 8, Z_DEFAULT_STRATEGY), Z_OK);
+    }
+
+    ~GzipOutputStream() {
+        Deflate(nullptr, 0, Z_FINISH);
+        deflateEnd(&zstream_);
+    }
+
+    void Write(const void *ptr, size_t size) override {
+        Deflate(ptr, size, Z_NO_FLUSH);
+    }
+
+private:
+    void Deflate(const void *ptr, size_t size, int flush) {
+        zstream_.next_in = static_cast<Bytef *>(const_cast<void *>(ptr));
+        zstream_.avail_in = static_cast<uInt>(size);
+        int status;
+        do {
+            zstream_.next_out = reinterpret_cast<Bytef *>(output_.data());
+            zstream_.avail_out = static_cast<uInt>(output_.size());
+            status = deflate(&zstream_, flush);
+            CHECK_NE(status, Z_STREAM_ERROR);
+            stream_->Write(output_.data(), output_.size() - zstream_.avail_out);
+        } while (zstream_.avail_out == 0 ||
+                 (flush == Z_FINISH && status != Z_STREAM_END));
+    }
+
+    std::unique_ptr<dmlc::Stream> stream_;
+    vector<char> output_;
+    z_stream zstream_;
+};
+
+#ifdef SYNTAXNET_USE_ZSTD
+
+class ZstdInputStream : public InputStream {
+public:
+    explicit ZstdInputStream(dmlc::Stream *stream)
+        : stream_(stream), input_(ZSTD_DStreamInSize()),
+          zstream_(ZSTD_createDStream()) {
+        CHECK(!ZSTD_isError(ZSTD_initDStream(zstream_)));
+    }
+
+    ~ZstdInputStream() { ZSTD_freeDStream(zstream_); }
+
+    size_t Read(void *ptr, size_t size) override {
+        ZSTD_outBuffer output = {ptr, size, 0};
+        while (output.pos < output.size) {
+            if (in_.pos == in_.size) {
+                in_.src = input_.data();
+                in_.size = stream_->Read(input_.data(), input_.size());
+                in_.pos = 0;
+                if (in_.size == 0) {
+                    // A frame is complete when the decoder needs no input.
+                    CHECK_EQ(hint_, 0) << "Truncated zstd file.";
+                    break;
+                }
+            }
+            hint_ = ZSTD_decompressStream(zstream_, &output, &in_);
+            CHECK(!ZSTD_isError(hint_)) << "Bad zstd data: "
+                                        << ZSTD_getErrorName(hint_);
+        }
+        return output.pos;
+    }
+
+private:
+    std::unique_ptr<dmlc::Stream> stream_;
+    vector<char> input_;
+    ZSTD_inBuffer in_ = {nullptr, 0, 0};
+    ZSTD_DStream *zstream_;
+
+    // Last return value of the decoder, 0 at the end of a frame.
+    size_t hint_ = 0;
+};
+
+class ZstdOutputStream : public OutputStream {
+public:
+    explicit ZstdOutputStream(dmlc::Stream *stream)
+        : stream_(stream), output_(ZSTD_CStreamOutSize()),
+          zstream_(ZSTD_createCStream()) {
+        CHECK(!ZSTD_isError(ZSTD_initCStream(zstream_, 3)));
+    }
+
+    ~ZstdOutputStream() {
+        size_t remaining;
+        do {
+            ZSTD_outBuffer output = {output_.data(), output_.size(), 0};
+            remaining = ZSTD_endStream(zstream_, &output);
+            CHECK(!ZSTD_isError(remaining));
+            stream_->Write(output_.data(), output.pos);
+        } while (remaining != 0);
+        ZSTD_freeCStream(zstream_);
+    }
+
+    void Write(const void *ptr, size_t size) override {
+        ZSTD_inBuffer input = {ptr, size, 0};
+        while (input.pos < input.size) {
+            ZSTD_outBuffer output = {output_.data(), output_.size(), 0};
+            const size_t status = ZSTD_compressStream(zstream_, &output, &input);
+            CHECK(!ZSTD_isError(status)) << ZSTD_getErrorName(status);
+            stream_->Write(output_.data(), output.pos);
+        }
+    }
+
+private:
+    std::unique_ptr<dmlc::Stream> stream_;
+    vector<char> output_;
+    ZSTD_CStream *zstream_;
+};
+
+#endif  // SYNTAXNET_USE_ZSTD
+
+// Fails for zstd files when built without zstd.
+void CheckSupported(Compression compression, const string &path) {
+#ifndef SYNTAXNET_USE_ZSTD
+    CHECK_NE(compression, kZstd)
+        << path << " is zstd-compressed, but SyntaxNet was built without zstd.";
+#endif
+}
+
+// Returns the compression of the file path by the magic bytes at the
+// beginning of stream, which is read from.
+Compression ReadCompression(dmlc::Stream *stream, const string &path) {
+    unsigned char magic[sizeof(kZstdMagic)];
+    const size_t size = ReadFully(stream, reinterpret_cast<char *>(magic),
+                                  sizeof(magic));
+    Compression compression = kNoCompression;
+    if (size >= sizeof(kGzipMagic) &&
+        memcmp(magic, kGzipMagic, sizeof(kGzipMagic)) == 0) {
+        compression = kGzip;
+    } else if (size >= sizeof(kZstdMagic) &&
+               memcmp(magic, kZstdMagic, sizeof(kZstdMagic)) == 0) {
+        compression = kZstd;
+    }
+    const Compression expected = OutputCompression(path);
+    CHECK(expected == kNoCompression || expected == compression)
+        << path << " is not a " << (expected == kGzip ? "gzip" : "zstd") << " file.";
+    return compression;
+}
+
+}  // namespace
+
+Compression FileCompression(const string &path) {
+    std::unique_ptr<dmlc::Stream> stream(dmlc::Stream::Create(path.c_str(), "r"));
+    return ReadCompression(stream.get(), path);
+}
+
+Compression OutputCompression(const string &path) {
+    if (HasSuffix(path, ".gz")) return kGzip;
+    if (HasSuffix(path, ".zst")) return kZstd;
+    return kNoCompression;
+}
+
+dmlc::Stream *OpenDecompressingInput(const string &path) {
+    // Sniff the magic bytes and read the file from the start again.
+    dmlc::SeekStream *stream = dmlc::SeekStream::CreateForRead(path.c_str());
+    const Compression compression = ReadCompression(stream, path);
+    stream->Seek(0);
+    CheckSupported(compression, path);
+    switch (compression) {
+        case kGzip:
+            return new GzipInputStream(stream);
+#ifdef SYNTAXNET_USE_ZSTD
+        case kZstd:
+            return new ZstdInputStream(stream);
+#endif
+        default:
+            return stream;
+    }
+}
+
+dmlc::Stream *CreateCompressingOutput(const string &path) {
+    const Compression compression = OutputCompression(path);
+    CheckSupported(compression, path);
+    dmlc::Stream *stream = dmlc::Stream::Create(path.c_str(), "w");
+    switch (compression) {
+        case kGzip:
+            return new GzipOutputStream(stream);
+#ifdef SYNTAXNET_USE_ZSTD
+        case kZstd:
+            return new ZstdOutputStream(stream);
+#endif
+        default:
+            return stream;
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef SYNTAXNET_COMPRESSION_H
+#define SYNTAXNET_COMPRESSION_H
+
+#include "../../dmlc-core/include/dmlc/io.h"
+
+#include "../base.h"
+
+/*!
+ * \brief Streaming gzip and zstd compression of corpus files.
+ *
+ * Input files are recognized by their magic bytes, so compressed corpora
+ * need no particular name; output files are compressed by their extension,
+ * ".gz" or ".zst". zstd is only available when SyntaxNet is built with it
+ * (SYNTAXNET_USE_ZSTD); files that need it fail otherwise.
+ */
+enum Compression { kNoCompression, kGzip, kZstd };
+
+// Returns the compression of a file by its magic bytes. A file named like a
+// compressed file must be one.
+Compression FileCompression(const string &path);
+
+// Returns the compression that output to path gets by its extension.
+Compression OutputCompression(const string &path);
+
+// Opens a file for reading. Compressed files are decompressed as they are
+// read. The caller owns the stream.
+dmlc::Stream *OpenDecompressingInput(const string &path);
+
+// Creates a file for writing, compressed as OutputCompression() says. The
+// compressed data is completed when the stream is deleted. The caller owns
+// the stream.
+dmlc::Stream *CreateCompressingOutput(const string &path);
+
+#endif //SYNTAXNET_COMPRESSION_H
@@ -0,0 +1,81 @@
+#include "conll_writer.h"
+
+#include "compression.h"
+#include "text_formats.h"
+
+CoNLLWriter::CoNLLWriter(const string &file, int window_size)
+    : output_(CreateCompressingOutput(file)),
+      window_(window_size),
+      waiting_(window_size, false) {
+    CHECK_GT(window_size, 0);
+}
+
+CoNLLWriter::~CoNLLWriter() {
+    if (output_ != nullptr) Close();
+}
+
+void CoNLLWriter::Write(int64_t index, const Sentence &sentence) {
+    CHECK(output_ != nullptr) << "Writing to a closed CoNLL writer.";
+    CHECK_GE(index, next_index_) << "Sentence " << index << " was written twice.";
+    if (index == next_index_) {
+        CoNLLSyntaxFormat::AppendSentence(sentence, &buffer_);
+        ++next_index_;
+        Drain();
+        return;
+    }
+    while (index - next_index_ >= static_cast<int64_t>(window_.size())) {
+        GrowWindow();
+    }
+    const size_t slot = index % window_.size();
+    CHECK(!waiting_[slot]) << "Sentence " << index << " was written twice.";
+    window_[slot].clear();
+    CoNLLSyntaxFormat::AppendSentence(sentence, &window_[slot]);
+    waiting_[slot] = true;
+    ++num_waiting_;
+}
+
+void CoNLLWriter::Drain() {
+    while (num_waiting_ > 0) {
+        const size_t slot = next_index_ % window_.size();
+        if (!waiting_[slot]) break;
+        buffer_.append(window_[slot]);
+        waiting_[slot] = false;
+        --num_waiting_;
+        ++next_index_;
+    }
+    if (buffer_.size() >= kFlushSize) WriteBuffer();
+}
+
+void CoNLLWriter::GrowWindow() {
+    const size_t size = window_.size();
+    vector<string> window(2 * size);
+    vector<bool> waiting(2 * size, false);
+    for (size_t offset = 0; offset < size; ++offset) {
+        const int64_t index = next_index_ + offset;
+        const size_t slot = index % size;
+        if (!waiting_[slot]) continue;
+        window[index % (2 * size)].swap(window_[slot]);
+        waiting[index % (2 * size)] = true;
+    }
+    window_.swap(window);
+    waiting_.swap(waiting);
+}
+
+void CoNLLWriter::Close() {
+    if (num_waiting_ > 0) {
+        LOG(WARNING) << "Writing " << num_waiting_ << " sentences after "
+                     << "missing sentence " << next_index_ << ".";
+    }
+    while (num_waiting_ > 0) {
+        // Skip the missing sentences.
+        while (!waiting_[next_index_ % window_.size()]) ++next_index_;
+        Drain();
+    }
+    WriteBuffer();
+    output_.reset();
+}
+
+void CoNLLWriter::WriteBuffer() {
+    output_->Write(buffer_.data(), buffer_.size());
+    buffer_.clear();
+}
@@ -0,0 +1,68 @@
+#ifndef SYNTAXNET_CONLL_WRITER_H
+#define SYNTAXNET_CONLL_WRITER_H
+
+#include <memory>
+
+#include "../../dmlc-core/include/dmlc/io.h"
+
+#include "../sentence.h"
+
+/*!
+ * \brief Writes sentences as CoNLL text in the order of their indices while
+ * they are finished out of order, e.g. by the states of a parsing batch.
+ *
+ * A sentence that is next in order is formatted straight into the output
+ * buffer, followed by the sentences after it that are already waiting.
+ * Sentences ahead of the next one wait, formatted, in a ring of buffers
+ * indexed by sentence index, so memory is bounded by how far sentences
+ * finish out of order, not by the corpus. The ring starts at window_size
+ * sentences and doubles when a sentence finishes further ahead. The output
+ * buffer is written out whenever it exceeds kFlushSize bytes.
+ */
+class CoNLLWriter {
+public:
+    // Bytes of formatted text buffered before they are written.
+    static const size_t kFlushSize = 1 << 16;
+
+    // Writes to file, which is "stdout" or a path. Files named *.gz or
+    // *.zst are compressed.
+    explicit CoNLLWriter(const string &file, int window_size = 64);
+
+    // Closes the output.
+    ~CoNLLWriter();
+
+    // Adds the index'th sentence, counting from 0. Each index must be added
+    // once.
+    void Write(int64_t index, const Sentence &sentence);
+
+    // Writes the waiting sentences in order, skipping the missing ones, and
+    // closes the output. Nothing can be written afterwards.
+    void Close();
+
+private:
+    // Moves the waiting sentences from the next one on to the output
+    // buffer, and writes it out if it is full.
+    void Drain();
+
+    // Doubles the ring of waiting sentences.
+    void GrowWindow();
+
+    // Writes out the output buffer.
+    void WriteBuffer();
+
+    std::unique_ptr<dmlc::Stream> output_;
+
+    // Formatted text not written out yet.
+    string buffer_;
+
+    // Index of the next sentence to write.
+    int64_t next_index_ = 0;
+
+    // Sentences waiting for the ones before them, at index % size, and
+    // whether each slot holds one.
+    vector<string> window_;
+    vector<bool> waiting_;
+    int num_waiting_ = 0;
+};
+
+#endif //SYNTAXNET_CONLL_WRITER_H
@@ -0,0 +1,70 @@
+/*!
+ * \brief Converts CoNLL corpora to the binary RecordIO sentence format.
+ *
+ * Usage:
+ *
+ *   corpus_converter [--word_map=word-map] [--tag_map=tag-map]
+ *                    [--label_map=label-map] <input pattern>... <output>
+ *
+ * The input patterns may be globs; the output is one RecordIO file, which
+ * is gzip or zstd compressed if it is named *.gz or *.zst. With
+ * term maps, the term ids of the tokens are stored as well, which saves the
+ * hash lookups of the features that use these maps. The converted corpus is
+ * read by setting the record format of the task input to
+ * "recordio-sentence".
+ */
+#include <string.h>
+
+#include <memory>
+
+#include "../../dmlc-core/include/dmlc/recordio.h"
+#include "compression.h"
+#include "recordio_format.h"
+#include "text_reader.h"
+
+int main(int argc, char **argv) {
+    string map_files[3];
+    const char *map_flags[3] = {"--word_map=", "--tag_map=", "--label_map="};
+    vector<string> files;
+    for (int i = 1; i < argc; ++i) {
+        bool is_flag = false;
+        for (int m = 0; m < 3; ++m) {
+            if (strncmp(argv[i], map_flags[m], strlen(map_flags[m])) == 0) {
+                map_files[m] = argv[i] + strlen(map_flags[m]);
+                is_flag = true;
+            }
+        }
+        if (!is_flag) files.push_back(argv[i]);
+    }
+    if (files.size() < 2) {
+        fprintf(stderr, "Usage: %s [--word_map=<map>] [--tag_map=<map>] "
+                "[--label_map=<map>] <input pattern>... <output>\n", argv[0]);
+        return 1;
+    }
+
+    std::unique_ptr<TermFrequencyMap> maps[3];
+    for (int m = 0; m < 3; ++m) {
+        if (!map_files[m].empty()) maps[m].reset(new TermFrequencyMap(map_files[m], 0, 0));
+    }
+    RecordIOSentenceFormat format;
+    format.set_term_maps(maps[0].get(), maps[1].get(), maps[2].get());
+
+    TaskInput input;
+    for (size_t i = 0; i + 1 < files.size(); ++i) {
+        input.add_part()->set_file_pattern(files[i]);
+    }
+    TextReader reader(input);
+    std::unique_ptr<dmlc::Stream> output(CreateCompressingOutput(files.back()));
+    dmlc::RecordIOWriter writer(output.get());
+    string key, value;
+    int64_t num_sentences = 0;
+    for (Sentence *sentence = reader.Read(); sentence != nullptr;
+         sentence = reader.Read()) {
+        format.ConvertToString(*sentence, &key, &value);
+        writer.WriteRecord(value);
+        reader.Release(sentence);
+        ++num_sentences;
+    }
+    LOG(INFO) << "Converted " << num_sentences << " sentences to " << files.back() << ".";
+    return 0;
+}
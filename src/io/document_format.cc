@@ -1,3 +1,27 @@
 #include "document_format.h"
+#include "compressed_split.h"
+#include "sentence_split.h"
 
 REGISTER_CLASS_REGISTRY("document format", DocumentFormat);
+
+bool DocumentFormat::ConvertToDocument(const string &key, StringPiece value,
+                                       Sentence *document) {
+    vector<Sentence *> documents;
+    ConvertFromBuffer(key, value, &documents);
+    CHECK_LE(documents.size(), 1);
+    document->Clear();
+    if (documents.empty()) return false;
+    document->Swap(documents[0]);
+    delete documents[0];
+    return true;
+}
+
+dmlc::InputSplit *DocumentFormat::CreateSplit(const string &uri,
+                                              unsigned part_index,
+                                              unsigned num_parts) {
+    if (CompressedSplit::HasCompressedFile(uri)) {
+        return new CompressedSplit(uri, part_index, num_parts,
+                                   &SentenceSplitter::FindLastSentenceBegin);
+    }
+    return new SentenceSplitter(uri, part_index, num_parts);
+}
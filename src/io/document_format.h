@@ -1,6 +1,8 @@
 #ifndef DOCUMENT_FORMAT_H_
 #define DOCUMENT_FORMAT_H_
 
+#include "../../dmlc-core/include/dmlc/io.h"
+
 #include "../sentence.h"
 #include "../utils/registry.h"
 
@@ -17,13 +19,41 @@ class DocumentFormat : public RegisterableClass<DocumentFormat> {
     // Returns false if no record could be read because we reached end of file.
     virtual bool ReadRecord(ifstream *stream, string *record) = 0;
 
+    // Reads a record from the front of an in-memory buffer, e.g. a mapped
+    // file, and advances the buffer past it. The record points into the
+    // buffer. Returns false if no record could be read, like the stream
+    // version.
+    virtual bool ReadRecord(StringPiece *buffer, StringPiece *record) = 0;
+
     // Converts a key/value pair to one or more documents.
     virtual void ConvertFromString(const string &key, const string &value,
         vector<Sentence *> *documents) = 0;
 
+    // Converts a key/value pair whose value points into a buffer. The default
+    // implementation copies the value for ConvertFromString().
+    virtual void ConvertFromBuffer(const string &key, StringPiece value,
+        vector<Sentence *> *documents) {
+        ConvertFromString(key, value.ToString(), documents);
+    }
+
+    // Converts a key/value pair that holds at most one document into
+    // *document, which is cleared first and may be a recycled document.
+    // Returns false if the value holds no document. The default
+    // implementation converts the value with ConvertFromBuffer().
+    virtual bool ConvertToDocument(const string &key, StringPiece value,
+        Sentence *document);
+
     // Converts a document to a key/value pair.
     virtual void ConvertToString(const Sentence &document,
         string *key, string *value) = 0;
+
+    // Returns a split of the files in uri (separated by ';') positioned at
+    // the part_index'th of num_parts shards, whose chunks hold whole
+    // records for ReadRecord(). The default splits text records separated
+    // by blank lines, and shards corpora with gzip or zstd compressed files
+    // by whole files.
+    virtual dmlc::InputSplit *CreateSplit(const string &uri,
+        unsigned part_index, unsigned num_parts);
 };
 
 #define REGISTER_DOCUMENT_FORMAT(type, component) \
@@ -0,0 +1,67 @@
+#include "npy_writer.h"
+
+#include <algorithm>
+
+namespace {
+
+// Values buffered before they are written.
+const size_t kBufferSize = 1 << 16;
+
+}  // namespace
+
+NpyWriter::NpyWriter(const string &path, int num_columns)
+    : path_(path), num_columns_(num_columns),
+      file_(path, std::ios::binary | std::ios::trunc) {
+    CHECK(file_) << "Cannot create " << path;
+    CHECK_GE(num_columns, 0);
+    const uint16_t one = 1;
+    CHECK_EQ(*reinterpret_cast<const char *>(&one), 1)
+        << ".npy files are written in little-endian byte order.";
+    WriteHeader();
+    buffer_.reserve(kBufferSize);
+}
+
+NpyWriter::~NpyWriter() {
+    if (file_.is_open()) Close();
+}
+
+void NpyWriter::Write(const int32_t *row) {
+    buffer_.insert(buffer_.end(), row, row + std::max(num_columns_, 1));
+    ++num_rows_;
+    if (buffer_.size() >= kBufferSize) Flush();
+}
+
+void NpyWriter::Close() {
+    Flush();
+    file_.seekp(0);
+    WriteHeader();
+    file_.close();
+    CHECK(!file_.fail()) << "Cannot write " << path_;
+}
+
+void NpyWriter::WriteHeader() {
+    string header = "{'descr': '<i4', 'fortran_order': False, 'shape': (";
+    header += std::to_string(num_rows_);
+    header += num_columns_ > 0 ? ", " + std::to_string(num_columns_) + "), }"
+                               : ",), }";
+
+    // Magic, version 1.0 and the little-endian size of the rest of the
+    // header, which is padded with spaces and ends in a newline.
+    const size_t prefix_size = 10;
+    CHECK_LT(header.size() + prefix_size, static_cast<size_t>(kHeaderSize));
+    header.resize(kHeaderSize - prefix_size - 1, ' ');
+    header.push_back('\n');
+    const uint16_t size = header.size();
+    const char prefix[prefix_size] = {
+        '\x93', 'N', 'U', 'M', 'P', 'Y', 1, 0,
+        static_cast<char>(size & 0xFF), static_cast<char>(size >> 8)};
+    file_.write(prefix, prefix_size);
+    file_.write(header.data(), header.size());
+}
+
+void NpyWriter::Flush() {
+    file_.write(reinterpret_cast<const char *>(buffer_.data()),
+                buffer_.size() * sizeof(int32_t));
+    CHECK(!file_.fail()) << "Cannot write " << path_;
+    buffer_.clear();
+}
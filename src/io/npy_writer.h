@@ -0,0 +1,55 @@
+#ifndef SYNTAXNET_NPY_WRITER_H
+#define SYNTAXNET_NPY_WRITER_H
+
+#include <fstream>
+
+#include "../base.h"
+
+/*!
+ * \brief Writes a matrix of int32 values, row by row, as a NumPy .npy file
+ * (format version 1.0, little-endian, C order), which numpy.load() can map
+ * with mmap_mode='r' instead of parsing.
+ *
+ * The number of rows is only known at the end, so the header is written
+ * with room for any row count and rewritten by Close(). With zero columns
+ * the file holds a vector, one value per row.
+ */
+class NpyWriter {
+public:
+    // Size of the header, which keeps the data 64-byte aligned.
+    static const int kHeaderSize = 128;
+
+    NpyWriter(const string &path, int num_columns);
+
+    // Closes the file if it is still open.
+    ~NpyWriter();
+
+    // Appends a row of max(num_columns, 1) values.
+    void Write(const int32_t *row);
+
+    // Appends a vector value.
+    void Write(int32_t value) { Write(&value); }
+
+    // Writes the header with the final shape and closes the file.
+    void Close();
+
+    int64_t num_rows() const { return num_rows_; }
+
+private:
+    // Writes the header for the current number of rows at the beginning of
+    // the file.
+    void WriteHeader();
+
+    // Writes out the buffered rows.
+    void Flush();
+
+    string path_;
+    int num_columns_;
+    int64_t num_rows_ = 0;
+    std::ofstream file_;
+
+    // Rows not written yet.
+    vector<int32_t> buffer_;
+};
+
+#endif //SYNTAXNET_NPY_WRITER_H
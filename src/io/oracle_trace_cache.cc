@@ -0,0 +1,40 @@
+#include "oracle_trace_cache.h"
+
+OracleTraceCache::OracleTraceCache(const string &path, int num_columns)
+    : path_(path), num_columns_(num_columns),
+      file_(path, std::ios::binary | std::ios::out | std::ios::trunc) {
+    CHECK(file_) << "Cannot create " << path;
+    CHECK_GE(num_columns, 0);
+}
+
+void OracleTraceCache::Write(const vector<int32_t> &trace) {
+    CHECK(!finished_) << "The oracle trace cache " << path_ << " is finished.";
+    CHECK_EQ(trace.size() % row_size(), 0);
+    const int64_t size = trace.size() * sizeof(int32_t);
+    file_.write(reinterpret_cast<const char *>(trace.data()), size);
+    CHECK(file_) << "Cannot write " << path_;
+    offsets_.push_back(size_);
+    size_ += size;
+}
+
+void OracleTraceCache::Finish() {
+    CHECK(!finished_);
+    file_.close();
+    CHECK(!file_.fail()) << "Cannot write " << path_;
+    file_.open(path_, std::ios::binary | std::ios::in);
+    CHECK(file_) << "Cannot read " << path_;
+    finished_ = true;
+    LOG(INFO) << "Cached the oracle traces of " << num_traces() << " sentences, "
+              << size_ / sizeof(int32_t) / row_size() << " states, in " << path_ << ".";
+}
+
+void OracleTraceCache::Read(int index, vector<int32_t> *trace) {
+    CHECK(finished_) << "The oracle trace cache " << path_ << " is being written.";
+    CHECK_GE(index, 0);
+    CHECK_LT(index, num_traces());
+    const int64_t end = index + 1 < num_traces() ? offsets_[index + 1] : size_;
+    trace->resize((end - offsets_[index]) / sizeof(int32_t));
+    file_.seekg(offsets_[index]);
+    file_.read(reinterpret_cast<char *>(trace->data()), end - offsets_[index]);
+    CHECK(file_) << "Cannot read " << path_;
+}
@@ -0,0 +1,49 @@
+#ifndef SYNTAXNET_ORACLE_TRACE_CACHE_H
+#define SYNTAXNET_ORACLE_TRACE_CACHE_H
+
+#include <fstream>
+
+#include "../base.h"
+
+/*!
+ * \brief File of the oracle traces of a corpus, which do not change between
+ * epochs: for each sentence, the states of its gold derivation, each as a
+ * row of its feature ids followed by the gold action taken in it.
+ *
+ * The traces are appended in one pass, then Finish() reopens the file for
+ * reading and each trace can be read back by its index, in any order. The
+ * offsets of the traces are kept in memory.
+ */
+class OracleTraceCache {
+public:
+    // Creates the cache file for rows of num_columns feature ids.
+    OracleTraceCache(const string &path, int num_columns);
+
+    // Values of a row: the feature ids and the action.
+    int row_size() const { return num_columns_ + 1; }
+
+    // Appends the trace of a sentence, its rows one after the other.
+    void Write(const vector<int32_t> &trace);
+
+    // Ends writing. Traces can be read from then on.
+    void Finish();
+
+    // Reads the index'th trace written.
+    void Read(int index, vector<int32_t> *trace);
+
+    bool finished() const { return finished_; }
+
+    int num_traces() const { return offsets_.size(); }
+
+private:
+    string path_;
+    int num_columns_;
+    bool finished_ = false;
+    std::fstream file_;
+
+    // Position of each trace in the file, and of the end of the last one.
+    vector<int64_t> offsets_;
+    int64_t size_ = 0;
+};
+
+#endif //SYNTAXNET_ORACLE_TRACE_CACHE_H
@@ -0,0 +1,251 @@
+#include "recordio_format.h"
+
+#include <string.h>
+
+#include <unordered_map>
+
+#include "../../dmlc-core/include/dmlc/recordio.h"
+#include "../../dmlc-core/src/io/recordio_split.h"
+#include "compressed_split.h"
+
+namespace {
+
+const uint32_t kMagic = dmlc::RecordIOWriter::kMagic;
+
+// Size of a RecordIO part of length bytes, padded to 4 bytes.
+inline uint32_t PaddedSize(uint32_t length) { return (length + 3U) & ~3U; }
+
+// Returns the index'th 32-bit word of data.
+inline uint32_t Word(const char *data, size_t index) {
+    uint32_t word;
+    memcpy(&word, data + 4 * index, sizeof(word));
+    return word;
+}
+
+// Appends value as an unsigned LEB128 varint.
+inline void AppendVarint(uint32_t value, string *data) {
+    while (value >= 0x80) {
+        data->push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    data->push_back(static_cast<char>(value));
+}
+
+// Reads a varint from *data, which must end before end, and advances *data
+// past it.
+inline uint32_t ReadVarint(const char **data, const char *end) {
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        CHECK(*data < end) << "Truncated sentence record.";
+        const uint8_t byte = static_cast<uint8_t>(*(*data)++);
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (byte < 0x80) return value;
+    }
+    LOG(FATAL) << "Bad varint in sentence record.";
+    return 0;
+}
+
+// Returns where the records in [begin, end) that are cut off by end begin,
+// or end if there are none. Walks the records from begin, which must be
+// the beginning of one.
+const char *FindLastRecordBegin(const char *begin, const char *end) {
+    const char *part = begin;
+    const char *record = begin;
+    while (static_cast<size_t>(end - part) >= 2 * sizeof(uint32_t)) {
+        CHECK_EQ(Word(part, 0), kMagic) << "Invalid RecordIO record.";
+        const uint32_t flag = dmlc::RecordIOWriter::DecodeFlag(Word(part, 1));
+        const uint32_t length = dmlc::RecordIOWriter::DecodeLength(Word(part, 1));
+        const size_t size = 2 * sizeof(uint32_t) + PaddedSize(length);
+        if (size > static_cast<size_t>(end - part)) break;
+        if (flag == 0 || flag == 1) record = part;
+        part += size;
+        if (flag == 0 || flag == 3) record = part;
+    }
+    return record;
+}
+
+}  // namespace
+
+bool RecordIOSentenceFormat::ReadRecord(ifstream *stream, string *record) {
+    record->clear();
+    uint32_t header[2];
+    while (stream->read(reinterpret_cast<char *>(header), sizeof(header))) {
+        CHECK_EQ(header[0], kMagic) << "Invalid RecordIO file.";
+        const uint32_t flag = dmlc::RecordIOWriter::DecodeFlag(header[1]);
+        const uint32_t length = dmlc::RecordIOWriter::DecodeLength(header[1]);
+        const size_t size = record->size();
+        record->resize(size + PaddedSize(length));
+        CHECK(stream->read(&(*record)[size], PaddedSize(length)))
+            << "Truncated RecordIO file.";
+        record->resize(size + length);
+        if (flag == 0 || flag == 3) return true;
+        record->append(reinterpret_cast<const char *>(&kMagic), sizeof(kMagic));
+    }
+    CHECK(record->empty()) << "Truncated RecordIO file.";
+    return false;
+}
+
+bool RecordIOSentenceFormat::ReadRecord(StringPiece *buffer, StringPiece *record) {
+    const char *part = buffer->data();
+    const char *end = part + buffer->size();
+    if (part == end) return false;
+    record_.clear();
+    while (true) {
+        CHECK_LE(2 * sizeof(uint32_t), static_cast<size_t>(end - part))
+            << "Truncated RecordIO record.";
+        CHECK_EQ(Word(part, 0), kMagic) << "Invalid RecordIO record.";
+        const uint32_t flag = dmlc::RecordIOWriter::DecodeFlag(Word(part, 1));
+        const uint32_t length = dmlc::RecordIOWriter::DecodeLength(Word(part, 1));
+        const char *data = part + 2 * sizeof(uint32_t);
+        CHECK_LE(PaddedSize(length), static_cast<size_t>(end - data))
+            << "Truncated RecordIO record.";
+        part = data + PaddedSize(length);
+        if (flag == 0) {
+            // The common case: the record is in one part.
+            *record = StringPiece(data, length);
+            break;
+        }
+        record_.append(data, length);
+        if (flag == 3) {
+            *record = record_;
+            break;
+        }
+        record_.append(reinterpret_cast<const char *>(&kMagic), sizeof(kMagic));
+    }
+    *buffer = StringPiece(part, end - part);
+    return true;
+}
+
+void RecordIOSentenceFormat::ConvertFromBuffer(const string &key, StringPiece value,
+                                               vector<Sentence *> *sentences) {
+    Sentence *sentence = new Sentence();
+    if (ConvertToDocument(key, value, sentence)) {
+        sentences->push_back(sentence);
+    } else {
+        delete sentence;
+    }
+}
+
+bool RecordIOSentenceFormat::ConvertToDocument(const string &key, StringPiece value,
+                                               Sentence *sentence) {
+    sentence->Clear();
+    const char *data = value.data();
+    const char *value_end = data + value.size();
+    CHECK_EQ(ReadVarint(&data, value_end), kVersion)
+        << "Unsupported sentence record version.";
+    const uint32_t flags = ReadVarint(&data, value_end);
+    const uint32_t num_tokens = ReadVarint(&data, value_end);
+    const uint32_t num_strings = ReadVarint(&data, value_end);
+    strings_.clear();
+    for (uint32_t i = 0; i < num_strings; ++i) {
+        const uint32_t size = ReadVarint(&data, value_end);
+        CHECK_LE(size, static_cast<size_t>(value_end - data))
+            << "Truncated sentence record.";
+        strings_.emplace_back(data, size);
+        data += size;
+    }
+    auto NextString = [&]() {
+        const uint32_t index = ReadVarint(&data, value_end);
+        CHECK_LT(index, num_strings) << "Bad string index in sentence record.";
+        return strings_[index];
+    };
+
+    // Add the tokens like the CoNLL reader does.
+    string &text = *sentence->mutable_text();
+    for (uint32_t t = 0; t < num_tokens; ++t) {
+        const StringPiece word = NextString();
+        const StringPiece category = NextString();
+        const StringPiece tag = NextString();
+        const StringPiece label = NextString();
+        const int head = static_cast<int>(ReadVarint(&data, value_end)) - 1;
+
+        if (!text.empty()) text.append(" ");
+        const int start = text.size();
+        const int end = start + word.size() - 1;
+        text.append(word.data(), word.size());
+
+        Token *token = sentence->add_token();
+        token->set_word(word);
+        token->set_start(start);
+        token->set_end(end);
+        if (head >= 0) token->set_head(head);
+        if (!tag.empty()) token->set_tag(tag);
+        if (!category.empty()) token->set_category(category);
+        if (!label.empty()) token->set_label(label);
+    }
+    if ((flags & kHasTermIds) != 0) {
+        for (uint32_t t = 0; t < num_tokens; ++t) {
+            Token *token = sentence->mutable_token(t);
+            token->set_word_id(static_cast<int>(ReadVarint(&data, value_end)) - 1);
+            token->set_tag_id(static_cast<int>(ReadVarint(&data, value_end)) - 1);
+            token->set_label_id(static_cast<int>(ReadVarint(&data, value_end)) - 1);
+        }
+    }
+
+    if (sentence->token_size() == 0) return false;
+    sentence->set_docid(key);
+    return true;
+}
+
+void RecordIOSentenceFormat::ConvertToString(const Sentence &sentence, string *key,
+                                             string *value) {
+    *key = sentence.docid();
+
+    // Intern the field strings in the order of their first use.
+    std::unordered_map<string, uint32_t> string_index;
+    vector<const string *> strings;
+    auto Intern = [&](StringPiece field) {
+        auto inserted = string_index.emplace(field.ToString(), strings.size());
+        if (inserted.second) strings.push_back(&inserted.first->first);
+        return inserted.first->second;
+    };
+    vector<uint32_t> tokens;
+    for (int t = 0; t < sentence.token_size(); ++t) {
+        const Token &token = sentence.token(t);
+        tokens.push_back(Intern(token.word()));
+        tokens.push_back(Intern(token.category()));
+        tokens.push_back(Intern(token.tag()));
+        tokens.push_back(Intern(token.label()));
+        tokens.push_back(token.head() + 1);
+    }
+    const bool has_term_ids =
+        word_map_ != nullptr || tag_map_ != nullptr || label_map_ != nullptr;
+
+    value->clear();
+    AppendVarint(kVersion, value);
+    AppendVarint(has_term_ids ? kHasTermIds : 0, value);
+    AppendVarint(sentence.token_size(), value);
+    AppendVarint(strings.size(), value);
+    for (const string *field : strings) {
+        AppendVarint(field->size(), value);
+        value->append(*field);
+    }
+    for (uint32_t number : tokens) AppendVarint(number, value);
+    if (has_term_ids) {
+        auto TermId = [](const TermFrequencyMap *map, StringPiece term) {
+            return map == nullptr ? -1 : map->LookupIndex(term, -1);
+        };
+        for (int t = 0; t < sentence.token_size(); ++t) {
+            const Token &token = sentence.token(t);
+            AppendVarint(TermId(word_map_, token.word()) + 1, value);
+            AppendVarint(TermId(tag_map_, token.tag()) + 1, value);
+            AppendVarint(TermId(label_map_, token.label()) + 1, value);
+        }
+    }
+}
+
+dmlc::InputSplit *RecordIOSentenceFormat::CreateSplit(const string &uri,
+                                                      unsigned part_index,
+                                                      unsigned num_parts) {
+    CHECK_LT(part_index, num_parts) << "Bad part " << part_index << " of "
+                                    << num_parts << " for " << uri;
+    if (CompressedSplit::HasCompressedFile(uri)) {
+        return new CompressedSplit(uri, part_index, num_parts, &FindLastRecordBegin);
+    }
+    dmlc::io::URI path(uri.c_str());
+    return new dmlc::io::RecordIOSplitter(
+        dmlc::io::FileSystem::GetInstance(path), uri.c_str(), part_index,
+        num_parts);
+}
+
+REGISTER_DOCUMENT_FORMAT("recordio-sentence", RecordIOSentenceFormat);
@@ -0,0 +1,91 @@
+#ifndef SYNTAXNET_RECORDIO_FORMAT_H
+#define SYNTAXNET_RECORDIO_FORMAT_H
+
+#include "../lexicon/term_frequency_map.h"
+#include "../sentence.h"
+#include "document_format.h"
+
+/*!
+ * \brief Binary document format for pre-tokenized corpora, stored as dmlc
+ * RecordIO records of one sentence each.
+ *
+ * A record holds the token fields that the CoNLL reader keeps (words,
+ * categories, tags, labels and heads), so reading it only copies them into
+ * the sentence instead of parsing text. The field strings are interned per
+ * record: each distinct string is stored once and the tokens refer to it by
+ * index. All numbers are unsigned LEB128 varints, so most take one byte:
+ *
+ *   header:   version, flags, number of tokens, number of strings
+ *   strings:  size and bytes of each string
+ *   tokens:   word, category, tag and label string indices and head + 1
+ *   term ids: word, tag and label ids + 1 of each token, if kHasTermIds is
+ *             set
+ *
+ * The sentence text is rebuilt from the words as the CoNLL reader does and
+ * the document id is the key. Term ids are stored when term maps are set
+ * for ConvertToString(); they become the lookup hints of the tokens.
+ *
+ * Files are split with dmlc's RecordIO splitter, so binary corpora are
+ * sharded like text ones, or by whole files if they are compressed.
+ * corpus_converter converts CoNLL corpora.
+ */
+class RecordIOSentenceFormat : public DocumentFormat {
+public:
+    // Flag of records with term ids.
+    static const uint32_t kHasTermIds = 1;
+
+    // Version of the record layout.
+    static const uint32_t kVersion = 1;
+
+    RecordIOSentenceFormat() {}
+
+    // Sets the maps whose ids ConvertToString() stores, or none if all are
+    // null. Terms missing from a map, or with a null map, get id -1. The
+    // maps are not owned.
+    void set_term_maps(const TermFrequencyMap *word_map,
+                       const TermFrequencyMap *tag_map,
+                       const TermFrequencyMap *label_map) {
+        word_map_ = word_map;
+        tag_map_ = tag_map;
+        label_map_ = label_map;
+    }
+
+    // Reads the next RecordIO record from a file.
+    bool ReadRecord(ifstream *stream, string *record) override;
+
+    // Reads the RecordIO record at the front of a chunk of a RecordIO file.
+    // Records that the writer split at embedded magic numbers are joined in
+    // an internal buffer, which is valid until the next call.
+    bool ReadRecord(StringPiece *buffer, StringPiece *record) override;
+
+    void ConvertFromString(const string &key, const string &value,
+                           vector<Sentence *> *sentences) override {
+        ConvertFromBuffer(key, value, sentences);
+    }
+
+    void ConvertFromBuffer(const string &key, StringPiece value,
+                           vector<Sentence *> *sentences) override;
+
+    bool ConvertToDocument(const string &key, StringPiece value,
+                           Sentence *sentence) override;
+
+    void ConvertToString(const Sentence &sentence, string *key,
+                         string *value) override;
+
+    dmlc::InputSplit *CreateSplit(const string &uri, unsigned part_index,
+                                  unsigned num_parts) override;
+
+private:
+    // Buffer for joined records.
+    string record_;
+
+    // Strings of the record being converted.
+    vector<StringPiece> strings_;
+
+    // Maps for the term ids written, or null. Not owned.
+    const TermFrequencyMap *word_map_ = nullptr;
+    const TermFrequencyMap *tag_map_ = nullptr;
+    const TermFrequencyMap *label_map_ = nullptr;
+};
+
+#endif //SYNTAXNET_RECORDIO_FORMAT_H
@@ -0,0 +1,88 @@
+#include "sentence_split.h"
+
+#include <string.h>
+
+namespace {
+
+inline bool IsLineEnd(char c) { return c == '\n' || c == '\r'; }
+
+}  // namespace
+
+SentenceSplitter::SentenceSplitter(const string &uri, unsigned part_index,
+                                   unsigned num_parts) {
+    CHECK_LT(part_index, num_parts) << "Bad part " << part_index << " of "
+                                    << num_parts << " for " << uri;
+    dmlc::io::URI path(uri.c_str());
+    Init(dmlc::io::FileSystem::GetInstance(path), uri.c_str(), 1);
+    ResetPartition(part_index, num_parts);
+}
+
+size_t SentenceSplitter::SeekRecordBegin(dmlc::Stream *fi) {
+    // Read up to the first byte after a blank line; that byte is not
+    // counted. Carriage returns do not end or break up line ends.
+    char c = '\0';
+    size_t num_bytes = 0;
+    int newlines = 0;
+    while (fi->Read(&c, sizeof(c)) != 0) {
+        if (newlines >= 2 && !IsLineEnd(c)) break;
+        ++num_bytes;
+        if (c == '\n') {
+            ++newlines;
+        } else if (c != '\r') {
+            newlines = 0;
+        }
+    }
+    return num_bytes;
+}
+
+const char *SentenceSplitter::FindLastRecordBegin(const char *begin,
+                                                  const char *end) {
+    return FindLastSentenceBegin(begin, end);
+}
+
+const char *SentenceSplitter::FindLastSentenceBegin(const char *begin,
+                                                    const char *end) {
+    CHECK(begin != end);
+    // Scan back for the last line that follows a blank line.
+    const char *p = end - 1;
+    while (p > begin) {
+        if (IsLineEnd(*p) || !IsLineEnd(p[-1])) {
+            --p;
+            continue;
+        }
+        const char *line_ends = p;
+        int newlines = 0;
+        while (line_ends > begin && IsLineEnd(line_ends[-1])) {
+            if (*--line_ends == '\n') ++newlines;
+        }
+        if (newlines >= 2) return p;
+        p = line_ends;
+    }
+    return begin;
+}
+
+bool SentenceSplitter::ExtractNextRecord(Blob *out_rec, Chunk *chunk) {
+    // Skip the blank lines before the sentence.
+    char *begin = chunk->begin;
+    while (begin != chunk->end && IsLineEnd(*begin)) ++begin;
+    chunk->begin = begin;
+    if (begin == chunk->end) return false;
+
+    // The sentence ends with the line before the next blank line.
+    char *end = begin;
+    while (end != chunk->end) {
+        char *newline = static_cast<char *>(memchr(end, '\n', chunk->end - end));
+        if (newline == nullptr) {
+            end = chunk->end;
+            break;
+        }
+        end = newline + 1;
+        const char *next = end;
+        while (next != chunk->end && *next == '\r') ++next;
+        if (next == chunk->end || *next == '\n') break;
+    }
+    out_rec->dptr = begin;
+    out_rec->size = end - begin;
+    chunk->begin = end;
+    return true;
+}
@@ -0,0 +1,44 @@
+#ifndef SYNTAXNET_SENTENCE_SPLIT_H
+#define SYNTAXNET_SENTENCE_SPLIT_H
+
+#include "../../dmlc-core/src/io/input_split_base.h"
+
+#include "../base.h"
+
+/*!
+ * \brief Input split over CoNLL-style corpora whose records (sentences) are
+ * separated by blank lines.
+ *
+ * Like dmlc's line splitter, the files are treated as one byte stream that
+ * is cut into num_parts contiguous byte ranges of about the same size, and
+ * every range is moved to the next record boundary, here the first line
+ * after a blank line. Each part therefore holds whole sentences, and the
+ * parts are disjoint and cover the corpus without the readers of different
+ * parts having to coordinate. Chunks returned by NextChunk() also end on a
+ * sentence boundary.
+ *
+ * A newline is inserted between files, so a file that ends in a newline
+ * but without a blank line does not run into the next one.
+ */
+class SentenceSplitter : public dmlc::io::InputSplitBase {
+public:
+    // Splits the files of uri, a list of paths or directories separated by
+    // ';', and positions the splitter at the beginning of the part_index'th
+    // of num_parts parts.
+    SentenceSplitter(const string &uri, unsigned part_index, unsigned num_parts);
+
+    bool ExtractNextRecord(Blob *out_rec, Chunk *chunk) override;
+
+    bool IsTextParser() override { return true; }
+
+    // Returns the beginning of the last line in [begin, end) that follows a
+    // blank line, or begin if there is none.
+    static const char *FindLastSentenceBegin(const char *begin, const char *end);
+
+protected:
+    size_t SeekRecordBegin(dmlc::Stream *fi) override;
+
+    const char *FindLastRecordBegin(const char *begin, const char *end) override;
+};
+
+#endif //SYNTAXNET_SENTENCE_SPLIT_H
@@ -0,0 +1,40 @@
+#include "shuffle_reader.h"
+
+#include <algorithm>
+
+ShuffleReader::ShuffleReader(TextReader *reader, int buffer_size, uint32_t seed)
+    : reader_(reader), buffer_size_(std::max(buffer_size, 1)), random_(seed) {
+    buffer_.reserve(buffer_size_);
+}
+
+ShuffleReader::~ShuffleReader() {
+    for (Sentence *sentence : buffer_) reader_->Release(sentence);
+}
+
+Sentence *ShuffleReader::Read() {
+    if (buffer_size_ == 1) return reader_->Read();
+
+    // Fills the buffer, at the start of the epoch, or takes the place of the
+    // sentence returned last.
+    while (buffer_.size() < buffer_size_ && !end_of_corpus_) {
+        Sentence *sentence = reader_->Read();
+        if (sentence == nullptr) {
+            end_of_corpus_ = true;
+        } else {
+            buffer_.push_back(sentence);
+        }
+    }
+    if (buffer_.empty()) return nullptr;
+    std::uniform_int_distribution<size_t> index(0, buffer_.size() - 1);
+    std::swap(buffer_[index(random_)], buffer_.back());
+    Sentence *sentence = buffer_.back();
+    buffer_.pop_back();
+    return sentence;
+}
+
+void ShuffleReader::Reset() {
+    for (Sentence *sentence : buffer_) reader_->Release(sentence);
+    buffer_.clear();
+    end_of_corpus_ = false;
+    reader_->Reset();
+}
@@ -0,0 +1,47 @@
+#ifndef SYNTAXNET_SHUFFLE_READER_H
+#define SYNTAXNET_SHUFFLE_READER_H
+
+#include <memory>
+#include <random>
+
+#include "text_reader.h"
+
+/*!
+ * \brief Reads the sentences of a TextReader in shuffled order, with bounded
+ * memory and in a single pass over the corpus.
+ *
+ * The reader keeps a buffer of up to buffer_size sentences read ahead, and
+ * each Read() returns a random one of them and refills its place from the
+ * corpus. A sentence is thus returned at most buffer_size - 1 reads before
+ * its position in the corpus, and the order is close to a random permutation
+ * once the buffer holds a good share of the corpus. Each epoch draws a new
+ * order from the same random sequence, so the orders only depend on the seed.
+ * With a buffer size of at most 1, sentences come in corpus order.
+ */
+class ShuffleReader {
+public:
+    // Takes ownership of the reader.
+    ShuffleReader(TextReader *reader, int buffer_size, uint32_t seed);
+    ~ShuffleReader();
+
+    // Returns the next sentence, or nullptr at the end of the corpus. The
+    // caller owns the sentence and should give it back with Release().
+    Sentence *Read();
+
+    // Takes back a sentence returned by Read() for reuse.
+    void Release(Sentence *sentence) { reader_->Release(sentence); }
+
+    // Starts a new epoch from the beginning of the corpus.
+    void Reset();
+
+private:
+    std::unique_ptr<TextReader> reader_;
+    size_t buffer_size_;
+    std::mt19937 random_;
+
+    // Sentences read ahead, and whether the corpus has been read to its end.
+    vector<Sentence *> buffer_;
+    bool end_of_corpus_ = false;
+};
+
+#endif //SYNTAXNET_SHUFFLE_READER_H
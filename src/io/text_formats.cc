@@ -0,0 +1,3 @@
+#include "text_formats.h"
+
+REGISTER_DOCUMENT_FORMAT("conll-sentence", CoNLLSyntaxFormat);
@@ -1,6 +1,8 @@
 #ifndef SYNTAXNET_TEXT_READER_H_
 #define SYNTAXNET_TEXT_READER_H_
 
+#include <string.h>
+
 #include <memory>
 #include <string>
 #include <vector>
@@ -40,49 +42,108 @@ class CoNLLSyntaxFormat : public DocumentFormat {
       return !record->empty();
     }
 
+    // Reads up to the first empty line like the stream version, scanning
+    // the buffer with memchr.
+    bool ReadRecord(StringPiece *buffer, StringPiece *record) override {
+      const char *begin = buffer->data();
+      const char *end = begin + buffer->size();
+      const char *line = begin;
+      while (line < end && *line != '\n') {
+        const char *newline =
+          static_cast<const char *>(memchr(line, '\n', end - line));
+        line = newline == nullptr ? end : newline + 1;
+      }
+      *record = StringPiece(begin, line - begin);
+
+      // Skip the empty line.
+      if (line < end) ++line;
+      *buffer = StringPiece(line, end - line);
+      return !record->empty();
+    }
+
     void ConvertFromString(const string &key, const string &value,
                            vector<Sentence *> *sentences) override {
+      ConvertFromBuffer(key, value, sentences);
+    }
+
+    void ConvertFromBuffer(const string &key, StringPiece value,
+                           vector<Sentence *> *sentences) override {
       // Create new sentence.
       Sentence *sentence = new Sentence();
+      if (ConvertToDocument(key, value, sentence)) {
+        sentences->push_back(sentence);
+      } else {
+        // If the sentence was empty (e.g., blank lines at the beginning of a
+        // file), then don't save it.
+        delete sentence;
+      }
+    }
+
+    // Parses the fields in place; only the token fields that are kept are
+    // copied into the sentence.
+    bool ConvertToDocument(const string &key, StringPiece value,
+                           Sentence *sentence) override {
+      sentence->Clear();
 
       // Each line corresponds to one token.
-      string text;
-      vector<string> lines = utils::Split(value, '\n');
+      string &text = *sentence->mutable_text();
+      const char *line = value.data();
+      const char *value_end = line + value.size();
 
       // Add each token to the sentence.
-      vector<string> fields;
+      StringPiece fields[kNumUsedFields];
       int expected_id = 1;
-      for (size_t i = 0; i < lines.size(); ++i) {
-        // Split line into tab-separated fields.
-        fields.clear();
-        fields = utils::Split(lines[i], '\t');
-        if (fields.size() == 0) continue;
+      while (line < value_end) {
+        const char *line_end =
+          static_cast<const char *>(memchr(line, '\n', value_end - line));
+        if (line_end == nullptr) line_end = value_end;
+        const char *next_line = line_end < value_end ? line_end + 1 : value_end;
+
+        // Split line into tab-separated fields, keeping the used ones.
+        if (line == line_end) {
+          line = next_line;
+          continue;
+        }
+        int num_fields = 0;
+        const char *field = line;
+        while (true) {
+          const char *tab =
+            static_cast<const char *>(memchr(field, '\t', line_end - field));
+          const char *field_end = tab == nullptr ? line_end : tab;
+          if (num_fields < kNumUsedFields) {
+            fields[num_fields] = StringPiece(field, field_end - field);
+          }
+          ++num_fields;
+          if (tab == nullptr) break;
+          field = tab + 1;
+        }
+        line = next_line;
 
         // Skip comment lines.
-        if (fields[0][0] == '#') continue;
+        if (fields[0].size() > 0 && fields[0][0] == '#') continue;
 
         // Check that the line is valid.
-        CHECK_GE(fields.size(), 8)
+        CHECK_GE(num_fields, 8)
           << "Every line has to have at least 8 tab separated fields.";
 
         // Check that the ids follow the expected format.
-        const int id = utils::ParseUsing<int>(fields[0], 0, utils::ParseInt32);
+        const int id = ParseIntField(fields[0]);
         CHECK_EQ(expected_id++, id)
           << "Token ids start at 1 for each new sentence and increase by 1 "
           << "on each new token. Sentences are separated by an empty line.";
 
         // Get relevant fields.
-        const string &word = fields[1];
-        const string &cpostag = fields[3];
-        const string &tag = fields[4];
-        const int head = utils::ParseUsing<int>(fields[6], 0, utils::ParseInt32);
-        const string &label = fields[7];
+        const StringPiece &word = fields[1];
+        const StringPiece &cpostag = fields[3];
+        const StringPiece &tag = fields[4];
+        const int head = ParseIntField(fields[6]);
+        const StringPiece &label = fields[7];
 
         // Add token to sentence text.
         if (!text.empty()) text.append(" ");
         const int start = text.size();
         const int end = start + word.size() - 1;
-        text.append(word);
+        text.append(word.data(), word.size());
 
         // Add token to sentence.
         Token *token = sentence->add_token();
@@ -95,39 +156,71 @@ class CoNLLSyntaxFormat : public DocumentFormat {
         if (!label.empty()) token->set_label(label);
       }
 
-      if (sentence->token_size() > 0) {
-        sentence->set_docid(key);
-        sentence->set_text(text);
-        sentences->push_back(sentence);
-      } else {
-        // If the sentence was empty (e.g., blank lines at the beginning of a
-        // file), then don't save it.
-        delete sentence;
-      }
+      if (sentence->token_size() == 0) return false;
+      sentence->set_docid(key);
+      return true;
     }
 
     // Converts a sentence to a key/value pair.
     void ConvertToString(const Sentence &sentence, string *key, string *value) override {
       *key = sentence.docid();
-      vector<string> lines;
+      value->clear();
+      AppendSentence(sentence, value);
+    }
+
+    // Appends the CoNLL lines of a sentence and the blank line after it to
+    // *output, formatting the fields in place.
+    static void AppendSentence(const Sentence &sentence, string *output) {
       for (int i = 0; i < sentence.token_size(); ++i) {
-        vector<string> fields(10);
-        fields[0] = utils::Printf(i + 1);
-        fields[1] = sentence.token(i).word();
-        fields[2] = "_";
-        fields[3] = sentence.token(i).category();
-        fields[4] = sentence.token(i).tag();
-        fields[5] = "_";
-        fields[6] = utils::Printf(sentence.token(i).head() + 1);
-        fields[7] = sentence.token(i).label();
-        fields[8] = "_";
-        fields[9] = "_";
-        lines.push_back(utils::Join(fields, "\t"));
+        const Token &token = sentence.token(i);
+        AppendInt(i + 1, output);
+        AppendField(token.word(), output);
+        output->append("\t_");
+        AppendField(token.category(), output);
+        AppendField(token.tag(), output);
+        output->append("\t_\t");
+        AppendInt(token.head() + 1, output);
+        AppendField(token.label(), output);
+        output->append("\t_\t_\n");
       }
-      *value = utils::Join(lines, "\n") + "\n\n";
+      output->append(sentence.token_size() == 0 ? "\n\n" : "\n");
     }
-};
 
-// REGISTER_DOCUMENT_FORMAT("conll-sentence", CoNLLSyntaxFormat);
+  private:
+    // Appends a tab and a field.
+    static void AppendField(StringPiece field, string *output) {
+      output->push_back('\t');
+      output->append(field.data(), field.size());
+    }
+
+    static void AppendInt(int value, string *output) {
+      char digits[16];
+      int size = 0;
+      unsigned magnitude = value < 0 ? -static_cast<unsigned>(value) : value;
+      do {
+        digits[size++] = '0' + magnitude % 10;
+        magnitude /= 10;
+      } while (magnitude != 0);
+      if (value < 0) output->push_back('-');
+      while (size > 0) output->push_back(digits[--size]);
+    }
+
+    // Number of leading fields that are used (up to DEPREL).
+    static const int kNumUsedFields = 8;
+
+    // Parses an integer field like utils::ParseInt32; empty fields are 0.
+    static int ParseIntField(StringPiece field) {
+      if (field.empty()) return 0;
+      char buffer[32];
+      if (field.size() >= sizeof(buffer)) {
+        return utils::ParseUsing<int>(field.ToString(), utils::ParseInt32);
+      }
+      memcpy(buffer, field.data(), field.size());
+      buffer[field.size()] = '\0';
+      int32_t value;
+      CHECK(utils::ParseInt32(buffer, &value)) << "Failed to convert: " << field;
+      return value;
+    }
+};
 
 #endif
@@ -1,46 +1,99 @@
 #include "text_reader.h"
 
-TextReader::TextReader(const TaskInput &input) {
-    file_name_ = TaskContext::InputFile(input);
-    // format_.reset(DocumentFormat::Create(input.record_format()));
-    format_.reset(new CoNLLSyntaxFormat());
-    Reset();
+#include <sys/stat.h>
+
+TextReader::TextReader(const TaskInput &input, int prefetch_size,
+                       int part_index, int num_parts)
+    : part_index_(part_index), num_parts_(num_parts) {
+    for (const string &file : TaskContext::InputFiles(input)) {
+        // The splitter fails on a corpus without data, so leave out empty
+        // files up front.
+        struct stat info;
+        if (stat(file.c_str(), &info) == 0 && S_ISREG(info.st_mode) &&
+            info.st_size == 0) {
+            continue;
+        }
+        if (!files_.empty()) files_.append(";");
+        files_.append(file);
+    }
+    format_.reset(DocumentFormat::Create(
+        input.record_format().empty() ? "conll-sentence" : input.record_format()));
+    Rewind();
+    if (prefetch_size > 0) {
+        prefetcher_.reset(new dmlc::ThreadedIter<Sentence>(prefetch_size));
+        prefetcher_->Init([this](Sentence **sentence) {
+            if (*sentence == nullptr) *sentence = new Sentence();
+            return ReadSentence(*sentence);
+        }, [this]() { Rewind(); });
+    }
 }
 
 Sentence *TextReader::Read() {
-    vector<Sentence *> sentences;
-    string key, value;
-    while (sentences.empty() && format_->ReadRecord(file_, &value)) {
-      //key = file_name_ + ":" + utils::Printf(sentence_count_);
-      key = utils::Printf(sentence_count_);
-      format_->ConvertFromString(key, value, &sentences);
-      CHECK_LE(sentences.size(), 1);
+    Sentence *sentence = nullptr;
+    if (prefetcher_ != nullptr) {
+        return prefetcher_->Next(&sentence) ? sentence : nullptr;
     }
+    if (free_sentences_.empty()) {
+        sentence = new Sentence();
+    } else {
+        sentence = free_sentences_.back();
+        free_sentences_.pop_back();
+    }
+    if (ReadSentence(sentence)) return sentence;
+    free_sentences_.push_back(sentence);
+    return nullptr;
+}
 
-    if (sentences.empty()) {
-        return nullptr;
+void TextReader::Release(Sentence *sentence) {
+    if (prefetcher_ != nullptr) {
+        prefetcher_->Recycle(&sentence);
     } else {
-        ++sentence_count_;
-        return sentences[0];
+        free_sentences_.push_back(sentence);
     }
+}
 
+bool TextReader::ReadSentence(Sentence *sentence) {
+    StringPiece value;
+    dmlc::InputSplit::Blob chunk;
+    do {
+        while (!remaining_.empty()) {
+            // Empty records are blank lines between sentences.
+            if (!format_->ReadRecord(&remaining_, &value)) continue;
+            //key = file_name_ + ":" + utils::Printf(sentence_count_);
+            const string key = std::to_string(sentence_count_);
+            if (format_->ConvertToDocument(key, value, sentence)) {
+                ++sentence_count_;
+                return true;
+            }
+        }
+        if (split_ == nullptr || !split_->NextChunk(&chunk)) return false;
+        remaining_ = StringPiece(static_cast<const char *>(chunk.dptr), chunk.size);
+    } while (true);
 }
 
 void TextReader::Reset() {
-    if (file_ != nullptr) {
-        file_->close();
-        delete file_;
+    if (prefetcher_ != nullptr) {
+        // Rewinds in the background thread and drops the queued sentences.
+        prefetcher_->BeforeFirst();
+    } else {
+        Rewind();
     }
+}
+
+void TextReader::Rewind() {
     sentence_count_ = 0;
-    file_ = new ifstream(file_name_);
-    if (!file_->is_open()) {
-        LOG(FATAL) << "Open file " << file_name_ << " failed.";
+    if (files_.empty()) {
+        // Nothing to read.
+    } else if (split_ == nullptr) {
+        split_.reset(format_->CreateSplit(files_, part_index_, num_parts_));
+    } else {
+        split_->BeforeFirst();
     }
+    remaining_ = StringPiece();
 }
 
 TextReader::~TextReader() {
-    if (file_ != nullptr) {
-        file_->close();
-        delete file_;
-    }
+    // Stop the background thread before the state it uses goes away.
+    prefetcher_.reset();
+    for (Sentence *sentence : free_sentences_) delete sentence;
 }
@@ -5,26 +5,74 @@
 #ifndef SYNTAXNET_TEXT_READER_H
 #define SYNTAXNET_TEXT_READER_H
 
+#include "../../dmlc-core/include/dmlc/threadediter.h"
 
 #include "../sentence.h"
 #include "document_format.h"
-#include "text_formats.h"
+#include "../utils/string_piece.h"
 #include "../utils/task_context.h"
 
+/*!
+ * \brief Reads the sentences of a corpus.
+ *
+ * The corpus is given by the file patterns of all parts of the task input,
+ * which may be globs, and its records are read with the document format
+ * registered under the input's record format ("conll-sentence" if it is
+ * empty). The files are read through the format's input split, so a reader
+ * can be restricted to the part_index'th of num_parts disjoint shards of
+ * the corpus, cut on record boundaries across and within files.
+ *
+ * With a positive prefetch size, a background thread reads and converts up
+ * to that many sentences ahead into a bounded queue, so that Read() only
+ * pops ready sentences. Sentences are recycled: callers hand them back with
+ * Release() and the reader refills them, keeping their token objects.
+ */
 class TextReader {
 public:
-    explicit TextReader(const TaskInput &input);
+    explicit TextReader(const TaskInput &input, int prefetch_size = 0,
+                        int part_index = 0, int num_parts = 1);
     ~TextReader();
 
+    // Returns the next sentence, or nullptr at the end of the corpus. The
+    // caller owns the sentence and should give it back with Release().
     Sentence *Read();
 
+    // Takes back a sentence returned by Read() for reuse.
+    void Release(Sentence *sentence);
+
+    // Starts reading from the beginning of the corpus. Sentences that have
+    // been read but not released stay valid.
     void Reset();
 
 private:
-    string file_name_;
+    // Reads the next sentence of the corpus into *sentence. Returns false at
+    // the end of the corpus.
+    bool ReadSentence(Sentence *sentence);
+
+    // Positions the reader at the beginning of its shard.
+    void Rewind();
+
+    // Non-empty files of the corpus, separated by ';'.
+    string files_;
+    int part_index_;
+    int num_parts_;
     int sentence_count_ = 0;
-    ifstream *file_;
+
+    // The shard is read in chunks of whole records, which are parsed in
+    // place.
+    std::unique_ptr<dmlc::InputSplit> split_;
+
+    // Part of the current chunk that has not been read yet.
+    StringPiece remaining_;
+
     std::unique_ptr<DocumentFormat> format_;
+
+    // Background reader, or null when reading synchronously. When set, all
+    // of the state above belongs to its thread.
+    std::unique_ptr<dmlc::ThreadedIter<Sentence>> prefetcher_;
+
+    // Released sentences when reading synchronously.
+    vector<Sentence *> free_sentences_;
 };
 
 
@@ -0,0 +1,198 @@
+#include "affix.h"
+
+#include <string.h>
+
+namespace {
+
+// Initial number of hash slots.
+const int kInitialSlots = 64;
+
+// Returns the number of bytes of the UTF-8 character starting with byte c.
+// Invalid lead bytes count as single-byte characters.
+inline int UTF8CharBytes(unsigned char c) {
+    if (c < 0xC0) return 1;
+    if (c < 0xE0) return 2;
+    if (c < 0xF0) return 3;
+    if (c < 0xF8) return 4;
+    return 1;
+}
+
+// Returns true for UTF-8 continuation bytes.
+inline bool IsContinuationByte(unsigned char c) { return (c & 0xC0) == 0x80; }
+
+}  // namespace
+
+AffixTable::AffixTable(Type type, int max_length) : type_(type) {
+    Reset(max_length);
+}
+
+void AffixTable::Reset(int max_length) {
+    CHECK_GE(max_length, 0);
+    max_length_ = max_length;
+    arena_.clear();
+    affixes_.clear();
+    slots_.assign(kInitialSlots, -1);
+}
+
+int AffixTable::AffixBytes(const char *word, size_t size, int length,
+                           size_t *start) const {
+    if (type_ == PREFIX) {
+        size_t end = 0;
+        for (int i = 0; i < length; ++i) {
+            if (end >= size) return -1;
+            end += UTF8CharBytes(word[end]);
+        }
+        *start = 0;
+        return end > size ? size : end;
+    } else {
+        size_t begin = size;
+        for (int i = 0; i < length; ++i) {
+            if (begin == 0) return -1;
+            --begin;
+            while (begin > 0 && IsContinuationByte(word[begin])) --begin;
+        }
+        *start = begin;
+        return size - begin;
+    }
+}
+
+void AffixTable::AddAffixesForWord(const char *word, size_t size) {
+    int shorter = -1;
+    for (int length = 1; length <= max_length_; ++length) {
+        size_t start;
+        const int bytes = AffixBytes(word, size, length, &start);
+        if (bytes < 0) break;
+        const char *form = word + start;
+        const uint32_t hash = HashBytes(form, bytes);
+        int id = Find(form, bytes, hash);
+        if (id < 0) id = AddNewAffix(form, bytes, hash, length, shorter);
+        shorter = id;
+    }
+}
+
+int AffixTable::AffixId(const char *form, size_t size) const {
+    return Find(form, size, HashBytes(form, size));
+}
+
+int AffixTable::AffixIdForWord(const char *word, size_t size,
+                               int length) const {
+    size_t start;
+    const int bytes = AffixBytes(word, size, length, &start);
+    if (bytes < 0) return -1;
+    return AffixId(word + start, bytes);
+}
+
+int AffixTable::Find(const char *form, size_t size, uint32_t hash) const {
+    const size_t mask = slots_.size() - 1;
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+        const int id = slots_[slot];
+        if (id < 0) return -1;
+        const Entry &entry = affixes_[id];
+        if (entry.hash == hash && entry.size == size &&
+            memcmp(arena_.data() + entry.offset, form, size) == 0) {
+            return id;
+        }
+    }
+}
+
+int AffixTable::AddNewAffix(const char *form, size_t size, uint32_t hash,
+                            int length, int shorter) {
+    CHECK_LE(size, std::numeric_limits<uint16_t>::max());
+    CHECK_LT(arena_.size() + size, std::numeric_limits<uint32_t>::max());
+    Entry entry;
+    entry.offset = arena_.size();
+    entry.hash = hash;
+    entry.size = size;
+    entry.length = length;
+    entry.shorter = shorter;
+    arena_.append(form, size);
+    affixes_.push_back(entry);
+    const int id = affixes_.size() - 1;
+
+    // Keep the load factor at or below one half.
+    if (2 * affixes_.size() > slots_.size()) {
+        slots_.assign(2 * slots_.size(), -1);
+        for (int i = 0; i < id; ++i) InsertSlot(i);
+    }
+    InsertSlot(id);
+    return id;
+}
+
+void AffixTable::InsertSlot(int id) {
+    const size_t mask = slots_.size() - 1;
+    size_t slot = affixes_[id].hash & mask;
+    while (slots_[slot] >= 0) slot = (slot + 1) & mask;
+    slots_[slot] = id;
+}
+
+void AffixTable::Save(const string &filename) const {
+    ofstream m_file(filename.c_str());
+    if (!m_file.is_open()) {
+        LOG(FATAL) << "Open file [ " << filename << " ] failed.";
+    }
+    m_file << (type_ == PREFIX ? "prefix" : "suffix") << " " << max_length_
+           << " " << size() << endl;
+    for (int id = 0; id < size(); ++id) {
+        const string form = AffixForm(id);
+        CHECK(form.find('\n') == string::npos);
+        m_file << form << endl;
+    }
+    m_file.close();
+    LOG(INFO) << "Saved " << size() << " affixes to " << filename << ".";
+}
+
+void AffixTable::Load(const string &filename) {
+    ifstream m_file(filename.c_str());
+    if (!m_file.is_open()) {
+        LOG(FATAL) << "Open file [ " << filename << " ] failed.";
+    }
+
+    // Read header.
+    string line;
+    std::getline(m_file, line);
+    const vector<string> header = utils::Split(line, ' ');
+    CHECK_EQ(3, header.size()) << "Bad affix table header in " << filename;
+    CHECK(header[0] == "prefix" || header[0] == "suffix")
+        << "Bad affix table type in " << filename << ": " << header[0];
+    int32_t max_length = -1;
+    int32_t total = -1;
+    CHECK(utils::ParseInt32(header[1].c_str(), &max_length));
+    CHECK(utils::ParseInt32(header[2].c_str(), &total));
+    CHECK_GE(total, 0);
+    type_ = header[0] == "prefix" ? PREFIX : SUFFIX;
+    Reset(max_length);
+
+    // Ids are implied by the order; the shorter affix of each one has a
+    // smaller id, so it is already in the table.
+    for (int i = 0; i < total; ++i) {
+        CHECK(std::getline(m_file, line))
+            << "File " << filename << " has only " << i << " affixes.";
+        CHECK(!line.empty());
+        const uint32_t hash = HashBytes(line.data(), line.size());
+        CHECK_EQ(Find(line.data(), line.size(), hash), -1)
+            << "File " << filename << " has duplicate affix: " << line;
+
+        // The length is the smallest one whose affix covers the whole form,
+        // counted the same way as when the table was built.
+        const int form_size = line.size();
+        int length = 0;
+        int bytes;
+        size_t start;
+        do {
+            ++length;
+            bytes = AffixBytes(line.data(), line.size(), length, &start);
+        } while (bytes >= 0 && bytes < form_size);
+        CHECK_EQ(bytes, form_size);
+        CHECK_LE(length, max_length_);
+        int shorter = -1;
+        if (length > 1) {
+            bytes = AffixBytes(line.data(), line.size(), length - 1, &start);
+            shorter = AffixId(line.data() + start, bytes);
+            CHECK_GE(shorter, 0) << "File " << filename
+                                 << " misses the shorter affix of " << line;
+        }
+        AddNewAffix(line.data(), line.size(), hash, length, shorter);
+    }
+    m_file.close();
+    LOG(INFO) << "Loaded " << size() << " affixes from " << filename << ".";
+}
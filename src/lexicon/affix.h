@@ -1,64 +1,120 @@
 #ifndef AFFIX_H_
 #define AFFIX_H_
 
+#include "../utils/string_piece.h"
 #include "../utils/utils.h"
 
 /*!
- * \brief An affix represents a prefix or suffix of a word of a certain length.
- * Each affix has a unique id and a textual form. An affix also has a pointer to
- * the affix that is one character shorter. This creates a chain of affixes that 
- * are successively shorter.
+ * \brief An affix table holds all prefixes or suffixes of words up to a
+ * maximum length (in UTF-8 characters). Each affix has a unique id and a
+ * textual form, and knows the id of the affix that is one character shorter,
+ * which creates a chain of successively shorter affixes.
+ *
+ * The affix forms are stored back to back in a single arena and indexed by an
+ * open-addressing hash table of affix ids, so lookups touch two contiguous
+ * arrays and never allocate. Ids are assigned in insertion order and shorter
+ * affixes of a word are always added before longer ones.
+ *
+ * Tables are saved in a text format similar to the term maps: a header line
+ * "<prefix|suffix> <max length> <number of affixes>" followed by one affix
+ * form per line in id order.
  */
-class Affix {
-private:
-    friend class AffixTable;
+class AffixTable {
+public:
+    // Affix table type.
+    enum Type {
+        PREFIX, SUFFIX
+    };
 
-    Affix(int id, const char *form, int length)
-            : id_(id), length_(length), form_(form), shorter_(NULL), next_(NULL) {}
+    AffixTable(Type type, int max_length);
 
-private:
-    // Affix id.
-    int id_;
+    // Loads a table written by Save(). This is the constructor used by the
+    // SharedStore.
+    explicit AffixTable(const string &filename) { Load(filename); }
 
-    // Length (in characters) of affix.
-    int length_;
+    Type type() const { return type_; }
 
-    // Text form of affix.
-    string form_;
+    int max_length() const { return max_length_; }
 
-    // Pointer to affix that is one character shorter.
-    Affix *shorter_;
+    // Number of affixes in the table.
+    int size() const { return affixes_.size(); }
 
-    // Next affix in bucket chain.
-    Affix *next_;
-};
+    // Removes all affixes and sets a new maximum length.
+    void Reset(int max_length);
 
+    // Adds all affixes of a word up to the maximum length.
+    void AddAffixesForWord(const char *word, size_t size);
 
-class AffixTable {
-public:
-    // Affix table type.
-    enum Type {
-        PREFIX, SUFFIX
-    };
+    void AddAffixesForWord(const string &word) {
+        AddAffixesForWord(word.data(), word.size());
+    }
+
+    // Returns the id of an affix form, or -1 if it is not in the table.
+    int AffixId(const char *form, size_t size) const;
+
+    int AffixId(const string &form) const {
+        return AffixId(form.data(), form.size());
+    }
+
+    // Returns the id of the affix of exactly length characters of a word, or
+    // -1 if the word is shorter or the affix is not in the table.
+    int AffixIdForWord(const char *word, size_t size, int length) const;
+
+    // Returns the textual form of an affix.
+    string AffixForm(int id) const {
+        const Entry &entry = affixes_[id];
+        return string(arena_.data() + entry.offset, entry.size);
+    }
+
+    // Returns the length of an affix in characters.
+    int AffixLength(int id) const { return affixes_[id].length; }
+
+    // Returns the id of the affix that is one character shorter, or -1.
+    int ShorterAffixId(int id) const { return affixes_[id].shorter; }
+
+    void Save(const string &filename) const;
+
+    void Load(const string &filename);
 
 private:
-    // Adds a new affix to table.
-    Affix *AddNewAffix(const string &form, int length);
+    // Affix in the table; the form is arena_[offset, offset + size).
+    struct Entry {
+        uint32_t offset;
+        uint32_t hash;
+        uint16_t size;
+        uint16_t length;
+        int32_t shorter;
+    };
+
+    // Returns the byte size of the affix of length characters of a word and
+    // stores where it starts in *start, or returns -1 if the word is shorter.
+    int AffixBytes(const char *word, size_t size, int length, size_t *start) const;
 
-    // Finds existing affix in table.
-    Affix *find(const string &form) const;
+    // Returns the id of a form with a known hash, or -1.
+    int Find(const char *form, size_t size, uint32_t hash) const;
+
+    // Adds a new affix to the table and returns its id.
+    int AddNewAffix(const char *form, size_t size, uint32_t hash, int length,
+                    int shorter);
+
+    // Inserts an id into the hash slots, which must have room for it.
+    void InsertSlot(int id);
 
     // Affix type (prefix or suffix).
-    Type type_;
+    Type type_ = PREFIX;
 
     // Maximum length of affix.
-    int max_length_;
+    int max_length_ = 0;
+
+    // Concatenated affix forms.
+    string arena_;
 
-    // Index from affix ids to affix items.
-    vector<Affix *> affixes_;
+    // Affixes indexed by id.
+    vector<Entry> affixes_;
 
-    // Buckets for word-to-affix hash map.
-    vector<Affix *> buckets_;
+    // Open-addressing hash table of affix ids with linear probing; -1 marks an
+    // empty slot. The size is a power of two, at least twice the table size.
+    vector<int32_t> slots_;
 };
 
 #endif
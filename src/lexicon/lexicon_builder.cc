@@ -1,74 +1,93 @@
+#include <stdio.h>
+
+#include <memory>
 #include <string>
+#include <thread>
+#include <utility>
 
 #include "../utils/utils.h"
+#include "affix.h"
 #include "term_frequency_map.h"
 #include "../sentence.h"
 #include "../options.h"
-#include "../io/text_formats.h"
+#include "../io/text_reader.h"
 
 /*!
- * \brief A workflow task that creates term maps. (e.g., word, tag, etc.).
+ * \brief Term frequency maps counted over a part of the corpus.
  */
-class LeiconBuilder {
-public:
-    void Compute(Options &options) {
-        // Term frequency maps to be populated by the corpus.
-        TermFrequencyMap words;
-        TermFrequencyMap lcwords;
-        TermFrequencyMap tags;
-        TermFrequencyMap categories;
-        TermFrequencyMap labels;
-
-        int64_t num_tokens = 0;
-        int64_t num_documents = 0;
-
-        // Read
-        ifstream m_file(options.input_file_);
-        if (!m_file.is_open()) {
-            LOG(INFO) << "Open file [" << options.input_file_ << "] failed.";
-            return;
+struct LexiconCounts {
+    TermFrequencyMap words;
+    TermFrequencyMap lcwords;
+    TermFrequencyMap tags;
+    TermFrequencyMap categories;
+    TermFrequencyMap labels;
+
+    int64_t num_tokens = 0;
+    int64_t num_documents = 0;
+
+    // Returns the maps with the suffixes of their spill files.
+    vector<pair<TermFrequencyMap *, string>> Maps() {
+        return {{&words, "words"}, {&lcwords, "lcwords"}, {&tags, "tags"},
+                {&categories, "categories"}, {&labels, "labels"}};
+    }
+
+    // Total number of terms in all maps.
+    int64_t NumTerms() const {
+        return words.Size() + lcwords.Size() + tags.Size() + categories.Size() +
+               labels.Size();
+    }
+
+    void Add(const Sentence &document) {
+        for (int t = 0; t < document.token_size(); ++t) {
+            const Token &token = document.token(t);
+            string word = token.word().ToString();
+            utils::NormalizeDigits(&word);
+            string lcword = utils::Lowercase(word);
+
+            CHECK(lcword.find('\n') == string::npos);
+            if (!word.empty() && !HasSpaces(word)) words.Increment(word);
+            if (!lcword.empty() && !HasSpaces(lcword)) lcwords.Increment(lcword);
+            if (!token.tag().empty()) tags.Increment(token.tag());
+            if (!token.category().empty()) categories.Increment(token.category());
+            if (!token.label().empty()) labels.Increment(token.label());
+
+            ++num_tokens;
         }
-        CoNLLSyntaxFormat readParser;
-        string record;
-        string doc_id = "conll";
-        vector<Sentence *> sentences;
-        while (readParser.ReadRecord(&m_file, &record)) {
-            readParser.ConvertFromString(doc_id, record, &sentences);
+        ++num_documents;
+    }
+
+    // Writes the maps to binary files named prefix + "." + map name and
+    // clears them. The token and document counts are kept.
+    void Spill(const string &prefix) {
+        for (const auto &map : Maps()) {
+            map.first->SaveBinary(prefix + "." + map.second);
+            map.first->Clear();
         }
-        m_file.close();
-
-        for (size_t i = 0; i < sentences.size(); ++i) {
-            Sentence *document = sentences[i];
-            for (int t = 0; t < document->token_size(); ++t) {
-                Token &token = document->token(t);
-                string word = token.word();
-                utils::NormalizeDigits(&word);
-                string lcword = utils::Lowercase(word);
-
-                CHECK(lcword.find('\n') == string::npos);
-                if (!word.empty() && !HasSpaces(word)) words.Increment(word);
-                if (!lcword.empty() && !HasSpaces(lcword)) lcwords.Increment(lcword);
-                if (!token.tag().empty()) tags.Increment(token.tag());
-                if (!token.category().empty()) categories.Increment(token.category());
-                if (!token.label().empty()) labels.Increment(token.label());
-
-                ++num_tokens;
+    }
+
+    // Adds the maps spilled with Spill(prefix) and deletes the files.
+    void AddSpilled(const string &prefix) {
+        for (const auto &map : Maps()) {
+            const string filename = prefix + "." + map.second;
+            {
+                TermFrequencyMap spilled(filename, 0, 0);
+                map.first->AddAll(spilled);
             }
-            ++num_documents;
+            remove(filename.c_str());
         }
+    }
 
-        LOG(INFO) << "Term maps collected over " << num_tokens << " tokens from "
-                  << num_documents << " documents.";
-
-        // Save into file.
-        words.Save(options.word_map_file_);
-        lcwords.Save(options.lc_word_map_file_);
-        tags.Save(options.tag_map_file_);
-        categories.Save(options.category_map_file_);
-        labels.Save(options.label_map_file_);
+    // Adds all counts of other.
+    void AddAll(LexiconCounts *other) {
+        const auto maps = Maps();
+        const auto other_maps = other->Maps();
+        for (size_t i = 0; i < maps.size(); ++i) {
+            maps[i].first->AddAll(*other_maps[i].first);
+        }
+        num_tokens += other->num_tokens;
+        num_documents += other->num_documents;
     }
 
-private:
     // Returns true if the word contains spaces.
     static bool HasSpaces(const string &word) {
         for (char c : word) {
@@ -78,6 +97,91 @@ private:
     }
 };
 
+/*!
+ * \brief A workflow task that creates term maps. (e.g., word, tag, etc.).
+ *
+ * The corpus is streamed: it is split into one shard per worker thread, cut
+ * on sentence boundaries, and each worker reads its shard and counts the
+ * terms into maps of its own, so only a chunk of the corpus per worker is in
+ * memory at any time. A worker whose maps hold more than the per-thread
+ * share of lexicon_max_terms_in_memory_ terms spills them to disk. At the
+ * end the spilled and in-memory maps are merged; since maps are saved
+ * sorted by frequency and term, the output does not depend on the number of
+ * threads.
+ */
+class LeiconBuilder {
+public:
+    void Compute(Options &options) {
+        int num_threads = options.lexicon_num_threads_;
+        if (num_threads <= 0) num_threads = std::thread::hardware_concurrency();
+        if (num_threads <= 0) num_threads = 1;
+        const int64_t max_terms_per_thread =
+            options.lexicon_max_terms_in_memory_ / num_threads;
+        const string spill_prefix = options.lexicon_spill_prefix_.empty()
+                                    ? options.word_map_file_ + ".spill"
+                                    : options.lexicon_spill_prefix_;
+
+        TaskInput input;
+        input.add_part()->set_file_pattern(options.input_file_);
+
+        // Count in worker threads, each reading its own shard.
+        vector<std::unique_ptr<LexiconCounts>> counts(num_threads);
+        vector<vector<string>> spills(num_threads);
+        vector<std::thread> workers;
+        for (int w = 0; w < num_threads; ++w) {
+            counts[w].reset(new LexiconCounts());
+            workers.emplace_back([&, w] {
+                TextReader reader(input, 0, w, num_threads);
+                for (Sentence *sentence = reader.Read(); sentence != nullptr;
+                     sentence = reader.Read()) {
+                    counts[w]->Add(*sentence);
+                    reader.Release(sentence);
+
+                    if (max_terms_per_thread > 0 &&
+                        counts[w]->NumTerms() > max_terms_per_thread) {
+                        spills[w].push_back(spill_prefix + "-" + utils::Printf(w) +
+                                            "-" + utils::Printf(spills[w].size()));
+                        counts[w]->Spill(spills[w].back());
+                    }
+                }
+            });
+        }
+        for (std::thread &worker : workers) worker.join();
+
+        // Merge into the counts of the first thread, one spill at a time.
+        LexiconCounts &total = *counts[0];
+        for (int w = 0; w < num_threads; ++w) {
+            if (w > 0) {
+                total.AddAll(counts[w].get());
+                counts[w].reset();
+            }
+            for (const string &spill : spills[w]) total.AddSpilled(spill);
+        }
+
+        LOG(INFO) << "Term maps collected over " << total.num_tokens
+                  << " tokens from " << total.num_documents << " documents.";
+
+        // Affix tables of the words, added in the order in which the words
+        // are saved, so that the ids do not depend on the order of counting.
+        AffixTable prefixes(AffixTable::PREFIX, options.max_prefix_length_);
+        AffixTable suffixes(AffixTable::SUFFIX, options.max_suffix_length_);
+        for (int index : total.words.SortedIndices()) {
+            const StringPiece word = total.words.Term(index);
+            prefixes.AddAffixesForWord(word.data(), word.size());
+            suffixes.AddAffixesForWord(word.data(), word.size());
+        }
+
+        // Save into file.
+        total.words.Save(options.word_map_file_);
+        total.lcwords.Save(options.lc_word_map_file_);
+        total.tags.Save(options.tag_map_file_);
+        total.categories.Save(options.category_map_file_);
+        total.labels.Save(options.label_map_file_);
+        prefixes.Save(options.prefix_table_file_);
+        suffixes.Save(options.suffix_table_file_);
+    }
+};
+
 
 class FeatureSize {
 public:
@@ -1,27 +1,108 @@
 #include "term_frequency_map.h"
 
-int TermFrequencyMap::Increment(const string &term) {
-    CHECK_EQ(term_index_.size(), term_data_.size());
-    const TermIndex::const_iterator it = term_index_.find(term);
-    if (it != term_index_.end()) {
+#include <string.h>
+
+namespace {
+
+// Initial number of hash slots.
+const int kInitialSlots = 64;
+
+// Binary term maps start with this magic string, which cannot start a text
+// map (whose first line is the number of terms).
+const char kBinaryMagic[8] = {'S', 'N', 'T', 'E', 'R', 'M', 'S', '\0'};
+
+// Version of the binary format. Files are written in native byte order, so
+// a byte-swapped file fails the version check.
+const uint32_t kBinaryVersion = 1;
+
+// Header of binary term maps. The sections follow in the order of their
+// offsets, each aligned to 8 bytes: the frequencies (an int64_t per term),
+// the entries (an Entry per term), the hash slots (an int32_t per slot) and
+// the arena. Terms are in order of descending frequency.
+struct BinaryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_terms;
+    uint32_t num_slots;
+    uint32_t arena_size;
+    uint64_t frequencies_offset;
+    uint64_t entries_offset;
+    uint64_t slots_offset;
+    uint64_t arena_offset;
+};
+
+// Rounds an offset up to a multiple of 8.
+uint64_t Align(uint64_t offset) { return (offset + 7) & ~static_cast<uint64_t>(7); }
+
+}  // namespace
+
+int TermFrequencyMap::Add(StringPiece term, int64_t frequency) {
+    CHECK(!mapped()) << "Cannot modify a mapped term map.";
+    CHECK_EQ(terms_.size(), frequencies_.size());
+    const uint32_t hash = HashBytes(term.data(), term.size());
+    const int index = Find(term.data(), term.size(), hash);
+    if (index >= 0) {
         // Increment the existing term.
-        pair<string, int64_t> &data = term_data_[it->second];
-        CHECK_EQ(term, data.first);
-        ++(data.second);
-        return it->second;
+        frequencies_[index] += frequency;
+        return index;
     } else {
         // Add a new term.
-        const int index = term_index_.size();
-        CHECK_LT(index, std::numeric_limits<int32_t>::max());
-        term_index_[term] = index;
-        term_data_.push_back(pair<string, int64_t>(term, 1));
-        return index;
+        return AddTerm(term.data(), term.size(), hash, frequency);
+    }
+}
+
+void TermFrequencyMap::AddAll(const TermFrequencyMap &other) {
+    for (int index = 0; index < other.Size(); ++index) {
+        Add(other.Term(index), other.Frequency(index));
     }
 }
 
 void TermFrequencyMap::Clear() {
-    term_index_.clear();
-    term_data_.clear();
+    mapped_file_.reset();
+    arena_.clear();
+    terms_.clear();
+    frequencies_.clear();
+    slots_.assign(kInitialSlots, -1);
+    UpdateView();
+}
+
+int TermFrequencyMap::AddTerm(const char *term, size_t size, uint32_t hash,
+                              int64_t frequency) {
+    CHECK_LT(terms_.size(), std::numeric_limits<int32_t>::max());
+    CHECK_LT(arena_.size() + size, std::numeric_limits<uint32_t>::max());
+    Entry entry;
+    entry.offset = arena_.size();
+    entry.size = size;
+    entry.hash = hash;
+    arena_.append(term, size);
+    terms_.push_back(entry);
+    frequencies_.push_back(frequency);
+    const int index = terms_.size() - 1;
+
+    // Keep the load factor at or below one half.
+    if (2 * terms_.size() > slots_.size()) {
+        slots_.assign(2 * slots_.size(), -1);
+        for (int i = 0; i < index; ++i) InsertSlot(i);
+    }
+    InsertSlot(index);
+    UpdateView();
+    return index;
+}
+
+void TermFrequencyMap::InsertSlot(int index) {
+    const size_t mask = slots_.size() - 1;
+    size_t slot = terms_[index].hash & mask;
+    while (slots_[slot] >= 0) slot = (slot + 1) & mask;
+    slots_[slot] = index;
+}
+
+void TermFrequencyMap::UpdateView() {
+    arena_data_ = arena_.data();
+    entry_data_ = terms_.data();
+    frequency_data_ = frequencies_.data();
+    slot_data_ = slots_.data();
+    num_slots_ = slots_.size();
+    num_terms_ = terms_.size();
 }
 
 void TermFrequencyMap::Load(const string &filename, int min_frequency, int max_num_terms) {
@@ -30,6 +111,23 @@ void TermFrequencyMap::Load(const string &filename, int min_frequency, int max_n
     // If max_num_terms is non-positive, replace it with INT_MAX.
     if (max_num_terms <= 0) max_num_terms = std::numeric_limits<int>::max();
 
+    char magic[sizeof(kBinaryMagic)] = {};
+    {
+        ifstream m_file(filename.c_str(), ios::binary);
+        if (!m_file.is_open()) {
+            LOG(FATAL) << "Open file [ " << filename << " ] failed.";
+        }
+        m_file.read(magic, sizeof(magic));
+    }
+    if (memcmp(magic, kBinaryMagic, sizeof(magic)) == 0) {
+        LoadBinary(filename, min_frequency, max_num_terms);
+    } else {
+        LoadText(filename, min_frequency, max_num_terms);
+    }
+}
+
+void TermFrequencyMap::LoadText(const string &filename, int min_frequency,
+                                int max_num_terms) {
     ifstream m_file(filename.c_str());
     if (!m_file.is_open()) {
         LOG(FATAL) << "Open file [ " << filename << " ] failed.";
@@ -42,17 +140,29 @@ void TermFrequencyMap::Load(const string &filename, int min_frequency, int max_n
     CHECK(utils::ParseInt32(line.c_str(), &total));
     CHECK_GE(total, 0);
 
+    // Size the hash table for all terms up front.
+    const int expected = std::min(total, max_num_terms);
+    size_t num_slots = kInitialSlots;
+    while (num_slots < 2 * static_cast<size_t>(expected)) num_slots *= 2;
+    slots_.assign(num_slots, -1);
+    terms_.reserve(expected);
+    frequencies_.reserve(expected);
+    UpdateView();
+
     int64_t last_frequency = -1;
     for (int i = 0; i < total && i < max_num_terms; ++i) {
         std::getline(m_file, line);
-        vector<string> elements = utils::Split(line, ' ');
-        CHECK_EQ(2, elements.size());
-        CHECK(!elements[0].empty());
-        CHECK(!elements[1].empty());
+
+        // Each line holds a term and its frequency, separated by one space.
+        const size_t space = line.find(' ');
+        CHECK(space != string::npos && line.find(' ', space + 1) == string::npos)
+            << "Bad line in " << filename << ": " << line;
+        CHECK_GT(space, 0);
+        CHECK_LT(space + 1, line.size());
         int64_t frequency = 0;
-        CHECK(utils::ParseInt64(elements[1].c_str(), &frequency));
+        CHECK(utils::ParseInt64(line.c_str() + space + 1, &frequency));
         CHECK_GT(frequency, 0);
-        const string &term = elements[0];
+        const StringPiece term(line.data(), space);
 
         // Check frequency sorting (descending order).
         if (i > 0) CHECK_GE(last_frequency, frequency);
@@ -62,34 +172,86 @@ void TermFrequencyMap::Load(const string &filename, int min_frequency, int max_n
         if (frequency < min_frequency) continue;
 
         // Check uniqueness of the mapped terms.
-        CHECK(term_index_.find(term) == term_index_.end())
+        const uint32_t hash = HashBytes(term.data(), term.size());
+        CHECK_EQ(Find(term.data(), term.size(), hash), -1)
             << "File " << filename << " has duplicate term: " << term;
 
         // Assign the next avaiable index.
-        const int index = term_index_.size();
-        term_index_[term] = index;
-        term_data_.push_back(pair<string, int64_t>(term, frequency));
+        AddTerm(term.data(), term.size(), hash, frequency);
     }
     m_file.close();
-    CHECK_EQ(term_index_.size(), term_data_.size());
-    LOG(INFO) << "Loaded " << term_index_.size() << " terms from " << filename << ".";
+    LOG(INFO) << "Loaded " << terms_.size() << " terms from " << filename << ".";
+}
+
+void TermFrequencyMap::LoadBinary(const string &filename, int min_frequency,
+                                  int max_num_terms) {
+    static_assert(sizeof(Entry) == 12, "Entry is part of the binary format");
+    mapped_file_.reset(new MappedFile(filename));
+    const char *data = mapped_file_->data();
+    const uint64_t size = mapped_file_->size();
+
+    // Check the header and that all sections are inside the file. The
+    // contents themselves are used as they are.
+    BinaryHeader header;
+    CHECK_GE(size, sizeof(header)) << "Truncated term map " << filename;
+    memcpy(&header, data, sizeof(header));
+    CHECK_EQ(header.version, kBinaryVersion)
+        << "Unsupported term map version in " << filename;
+    CHECK_GT(header.num_slots, header.num_terms) << "Bad term map " << filename;
+    CHECK_EQ(header.num_slots & (header.num_slots - 1), 0)
+        << "Bad term map " << filename;
+    const uint64_t sections[][2] = {
+        {header.frequencies_offset, header.num_terms * sizeof(int64_t)},
+        {header.entries_offset, header.num_terms * sizeof(Entry)},
+        {header.slots_offset, header.num_slots * sizeof(int32_t)},
+        {header.arena_offset, header.arena_size}};
+    for (const auto &section : sections) {
+        CHECK_EQ(section[0] % 8, 0) << "Bad term map " << filename;
+        CHECK_LE(section[0], size) << "Truncated term map " << filename;
+        CHECK_LE(section[1], size - section[0]) << "Truncated term map " << filename;
+    }
+
+    arena_data_ = data + header.arena_offset;
+    entry_data_ = reinterpret_cast<const Entry *>(data + header.entries_offset);
+    frequency_data_ =
+        reinterpret_cast<const int64_t *>(data + header.frequencies_offset);
+    slot_data_ = reinterpret_cast<const int32_t *>(data + header.slots_offset);
+    num_slots_ = header.num_slots;
+
+    // The terms are sorted by descending frequency, so the terms that are
+    // kept are a prefix.
+    num_terms_ = std::min<int64_t>(header.num_terms, max_num_terms);
+    while (num_terms_ > 0 && frequency_data_[num_terms_ - 1] < min_frequency) {
+        --num_terms_;
+    }
+    LOG(INFO) << "Mapped " << num_terms_ << " terms from " << filename << ".";
 }
 
 struct TermFrequencyMap::SortByFrequencyThenTerm {
+    explicit SortByFrequencyThenTerm(const TermFrequencyMap *map) : map(map) {}
+
     // Return a > b to sort in descending order of frequency; otherwise,
     // lexicographic sort on term.
-    bool operator()(const pair<string, int64_t> &a,
-                    const pair<string, int64_t> &b) const {
-        return (a.second > b.second || (a.second == b.second && a.first < b.first));
+    bool operator()(int a, int b) const {
+        const int64_t freq_a = map->Frequency(a);
+        const int64_t freq_b = map->Frequency(b);
+        return (freq_a > freq_b ||
+                (freq_a == freq_b && map->Term(a) < map->Term(b)));
     }
+
+    const TermFrequencyMap *map;
 };
 
-void TermFrequencyMap::Save(const string &filename) const {
-    CHECK_EQ(term_index_.size(), term_data_.size());
+vector<int> TermFrequencyMap::SortedIndices() const {
+    vector<int> sorted_indices(Size());
+    for (size_t i = 0; i < sorted_indices.size(); ++i) sorted_indices[i] = i;
+    std::sort(sorted_indices.begin(), sorted_indices.end(),
+              SortByFrequencyThenTerm(this));
+    return sorted_indices;
+}
 
-    // Copy and sort the term data.
-    vector<pair<string, int64_t> > sorted_data(term_data_);
-    std::sort(sorted_data.begin(), sorted_data.end(), SortByFrequencyThenTerm());
+void TermFrequencyMap::Save(const string &filename) const {
+    const vector<int> sorted_indices = SortedIndices();
 
     // Write the number of terms.
     ofstream m_file(filename.c_str());
@@ -97,23 +259,72 @@ void TermFrequencyMap::Save(const string &filename) const {
         LOG(FATAL) << "Open file [ " << filename << " failed";
     }
     // Header
-    const int32_t num_terms = term_index_.size();
+    const int32_t num_terms = Size();
     m_file << num_terms << endl;
 
-    for (size_t i = 0; i < sorted_data.size(); ++i) {
-        if (i > 0) CHECK_GE(sorted_data[i - 1].second, sorted_data[i].second);
-        m_file << sorted_data[i].first << " " << sorted_data[i].second << endl;
+    for (size_t i = 0; i < sorted_indices.size(); ++i) {
+        const int index = sorted_indices[i];
+        if (i > 0) CHECK_GE(Frequency(sorted_indices[i - 1]), Frequency(index));
+        m_file << Term(index) << " " << Frequency(index) << endl;
+    }
+    m_file.close();
+    LOG(INFO) << "Saved " << Size() << " terms to " << filename << ".";
+}
+
+void TermFrequencyMap::SaveBinary(const string &filename) const {
+    // Rebuild the map in the order of the text format.
+    TermFrequencyMap sorted;
+    for (int index : SortedIndices()) {
+        const StringPiece term = Term(index);
+        sorted.AddTerm(term.data(), term.size(), entry_data_[index].hash,
+                       Frequency(index));
+    }
+
+    BinaryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kBinaryMagic, sizeof(kBinaryMagic));
+    header.version = kBinaryVersion;
+    header.num_terms = sorted.terms_.size();
+    header.num_slots = sorted.slots_.size();
+    header.arena_size = sorted.arena_.size();
+    header.frequencies_offset = Align(sizeof(header));
+    header.entries_offset =
+        Align(header.frequencies_offset + header.num_terms * sizeof(int64_t));
+    header.slots_offset =
+        Align(header.entries_offset + header.num_terms * sizeof(Entry));
+    header.arena_offset =
+        Align(header.slots_offset + header.num_slots * sizeof(int32_t));
+
+    ofstream m_file(filename.c_str(), ios::binary);
+    if (!m_file.is_open()) {
+        LOG(FATAL) << "Open file [ " << filename << " ] failed.";
     }
+    uint64_t position = 0;
+    auto write = [&](uint64_t offset, const void *data, size_t size) {
+        static const char kPadding[8] = {};
+        CHECK_LE(position, offset);
+        m_file.write(kPadding, offset - position);
+        m_file.write(static_cast<const char *>(data), size);
+        position = offset + size;
+    };
+    write(0, &header, sizeof(header));
+    write(header.frequencies_offset, sorted.frequencies_.data(),
+          header.num_terms * sizeof(int64_t));
+    write(header.entries_offset, sorted.terms_.data(),
+          header.num_terms * sizeof(Entry));
+    write(header.slots_offset, sorted.slots_.data(),
+          header.num_slots * sizeof(int32_t));
+    write(header.arena_offset, sorted.arena_.data(), header.arena_size);
     m_file.close();
-    LOG(INFO) << "Saved " << term_index_.size() << " terms to " << filename << ".";
+    CHECK(!m_file.fail()) << "Writing file [ " << filename << " ] failed.";
+    LOG(INFO) << "Saved " << Size() << " terms to " << filename << ".";
 }
 
 string TermFrequencyMap::ToString() const {
     string str;
-    TermIndex::const_iterator it = term_index_.begin();
-    for (; it != term_index_.end(); ++it) {
-        str += it->first + ":";
-        str += utils::Printf(it->second) + "\n";
+    for (int index = 0; index < Size(); ++index) {
+        str += GetTerm(index) + ":";
+        str += utils::Printf(index) + "\n";
     }
     return str;
 }
@@ -2,61 +2,177 @@
 #define TERM_FREQUENCY_MAP_H_
 
 #include <stddef.h>
+#include <string.h>
 #include <string>
 #include <vector>
 #include <map>
-#include <unordered_map>
+#include <memory>
 
+#include "../utils/mapped_file.h"
+#include "../utils/string_piece.h"
 #include "../utils/utils.h"
 
 /*!
  * \brief A mapping from strings to frequencies with save and load
  * functionality.
+ *
+ * The terms are stored back to back in a single arena and indexed by an
+ * open-addressing hash table of term indices, so a lookup hashes the key
+ * once, probes a contiguous array and compares bytes in place. Lookups take
+ * a StringPiece and never copy or allocate.
+ *
+ * Maps are saved either as text, one "term frequency" line per term after a
+ * line with the number of terms, or in a binary format that holds the arena,
+ * the term entries, the frequencies and the hash table exactly as they are
+ * laid out in memory. Load() detects the format. Binary maps are mapped
+ * read-only and used in place without parsing, so processes that load the
+ * same map share its pages; such maps cannot be modified.
  */
 class TermFrequencyMap {
 public:
-    TermFrequencyMap() {}
+    TermFrequencyMap() { Clear(); }
 
     TermFrequencyMap(const string &file, int min_frequency, int max_num_terms) {
         Load(file, min_frequency, max_num_terms);
     }
 
-    int Size() const { return term_index_.size(); }
+    TermFrequencyMap(const TermFrequencyMap &) = delete;
+
+    TermFrequencyMap &operator=(const TermFrequencyMap &) = delete;
+
+    int Size() const { return num_terms_; }
 
     // Returns the index associated with the given term. If the
     // term does not exist, the unknown index is returned instead.
-    int LookupIndex(const string &term, int unknown) const {
-        const TermIndex::const_iterator it = term_index_.find(term);
-        return (it != term_index_.end() ? it->second : unknown);
+    int LookupIndex(StringPiece term, int unknown) const {
+        const int index = Find(term.data(), term.size(),
+                               HashBytes(term.data(), term.size()));
+        return index >= 0 ? index : unknown;
+    }
+
+    // Like LookupIndex(term, unknown), but first tries the index hint, e.g.
+    // an id precomputed for the term, which only costs a comparison with
+    // the term at that index. Negative hints are ignored.
+    int LookupIndex(StringPiece term, int hint, int unknown) const {
+        if (hint >= 0 && hint < num_terms_ && Term(hint) == term) return hint;
+        return LookupIndex(term, unknown);
     }
 
-    // Returns the term associated with the given index.
-    const string &GetTerm(int index) const {
-        return term_data_[index].first;
+    // Returns the term associated with the given index. The piece points
+    // into the map and is valid until the map is modified.
+    StringPiece Term(int index) const {
+        const Entry &entry = entry_data_[index];
+        return StringPiece(arena_data_ + entry.offset, entry.size);
     }
 
+    // Returns a copy of the term associated with the given index.
+    string GetTerm(int index) const { return Term(index).ToString(); }
+
+    // Returns the frequency of the term associated with the given index.
+    int64_t Frequency(int index) const { return frequency_data_[index]; }
+
+    // Returns true if the map uses a mapped binary file in place.
+    bool mapped() const { return mapped_file_ != nullptr; }
+
     // Increases the frequency of the given term by 1, creating a
     // new entry if necessary, and returns the index of the term.
-    int Increment(const string &term);
+    int Increment(StringPiece term) { return Add(term, 1); }
+
+    // Increases the frequency of the given term by frequency, creating a new
+    // entry if necessary, and returns the index of the term.
+    int Add(StringPiece term, int64_t frequency);
+
+    // Adds the frequencies of all terms of another map.
+    void AddAll(const TermFrequencyMap &other);
+
+    // Returns the term indices in the order in which the terms are saved:
+    // by descending frequency, then by term.
+    vector<int> SortedIndices() const;
 
     void Clear();
 
+    // Loads a text or binary map. Terms with a frequency below min_frequency
+    // and terms beyond the first max_num_terms (if positive) are dropped.
     void Load(const string &filename, int min_frequency, int max_num_terms);
 
+    // Saves the map in the text format.
     void Save(const string &filename) const;
 
+    // Saves the map in the binary format. Like Save(), the terms are written
+    // in order of descending frequency, so the term indices of the loaded map
+    // are the same for both formats.
+    void SaveBinary(const string &filename) const;
+
     string ToString() const;
 
 private:
-    // Hashtable for term-to-index mapping.
-    typedef std::unordered_map<string, int> TermIndex;
-
-    // Sorting functor for term data.
+    // Term in the map; the term is the arena range [offset, offset + size).
+    // This is also the layout of the entries in binary files.
+    struct Entry {
+        uint32_t offset;
+        uint32_t size;
+        uint32_t hash;
+    };
+
+    // Sorting functor for term indices.
     struct SortByFrequencyThenTerm;
 
-    TermIndex term_index_;
+    // Returns the index of a term with a known hash, or -1. The hash table of
+    // a binary map also holds the terms dropped when loading it, which must
+    // not be found.
+    int Find(const char *term, size_t size, uint32_t hash) const {
+        const size_t mask = num_slots_ - 1;
+        for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+            const int index = slot_data_[slot];
+            if (index < 0) return -1;
+            const Entry &entry = entry_data_[index];
+            if (entry.hash == hash && entry.size == size &&
+                memcmp(arena_data_ + entry.offset, term, size) == 0) {
+                return index < num_terms_ ? index : -1;
+            }
+        }
+    }
+
+    void LoadText(const string &filename, int min_frequency, int max_num_terms);
+
+    void LoadBinary(const string &filename, int min_frequency, int max_num_terms);
+
+    // Adds a new term with the given frequency and returns its index.
+    int AddTerm(const char *term, size_t size, uint32_t hash, int64_t frequency);
+
+    // Inserts an index into the hash slots, which must have room for it.
+    void InsertSlot(int index);
+
+    // Points the view below at the owned storage.
+    void UpdateView();
+
+    // Storage of maps that are built or loaded from text.
+
+    // Concatenated terms.
+    string arena_;
+
+    // Terms indexed by term index.
+    vector<Entry> terms_;
+
+    // Term frequencies indexed by term index. They are kept apart from the
+    // entries since lookups never read them.
+    vector<int64_t> frequencies_;
+
+    // Open-addressing hash table of term indices with linear probing; -1
+    // marks an empty slot. The size is a power of two, at least twice the
+    // number of terms.
+    vector<int32_t> slots_;
+
+    // Mapping of a binary map, or null.
+    std::unique_ptr<MappedFile> mapped_file_;
 
-    vector<pair<string, int64_t> > term_data_;
+    // View of the map, either the storage above or the mapped file.
+    const char *arena_data_ = nullptr;
+    const Entry *entry_data_ = nullptr;
+    const int64_t *frequency_data_ = nullptr;
+    const int32_t *slot_data_ = nullptr;
+    size_t num_slots_ = 0;
+    int num_terms_ = 0;
 };
 
 class TagToCategoryMap {
@@ -0,0 +1,38 @@
+/*!
+ * \brief Converts term maps between the text and the binary format.
+ *
+ * Usage:
+ *
+ *   term_map_converter [--text] <input map> <output map>
+ *
+ * The input may be in either format. The output is binary unless --text is
+ * given. Term indices are the same in both formats, so a binary map can
+ * replace the text map it was converted from, e.g. word-map.
+ */
+#include <string.h>
+
+#include "term_frequency_map.h"
+
+int main(int argc, char **argv) {
+    bool text = false;
+    vector<string> files;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--text") == 0) {
+            text = true;
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+    if (files.size() != 2) {
+        fprintf(stderr, "Usage: %s [--text] <input map> <output map>\n", argv[0]);
+        return 1;
+    }
+
+    TermFrequencyMap map(files[0], 0, 0);
+    if (text) {
+        map.Save(files[1]);
+    } else {
+        map.SaveBinary(files[1]);
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+/*!
+ * \brief Aligns pretrained word vectors to a word map and saves them as the
+ * word embedding matrix of the greedy parser network.
+ *
+ * Usage:
+ *
+ *   word_embedding_loader [--word_map=word-map] [--num_rows=0]
+ *                         [--name=0_embed_weight] [--threads=0] [--seed=1]
+ *                         <word vectors> <output .params file>
+ *
+ * The vectors are read from a word2vec or fastText text file, or a word2vec
+ * binary file ending in ".bin" (see word_embeddings.h). Row i of the matrix
+ * is the vector of term i of the word map. There are num_rows rows, by
+ * default one per term and three more for the unknown, outside and root ids
+ * of the word features. Words without a vector get random rows.
+ *
+ * The matrix is saved as an mxnet NDArray list holding the single array
+ * "arg:<name>", which mx.nd.load() reads for the embedding of
+ * graph_builder.py's first feature group.
+ */
+#include <string.h>
+
+#include <chrono>
+#include <thread>
+
+#include "../model/greedy_network.h"
+#include "term_frequency_map.h"
+#include "word_embeddings.h"
+
+int main(int argc, char **argv) {
+    string word_map_path = "word-map";
+    string name = "0_embed_weight";
+    int num_rows = 0;
+    int num_threads = 0;
+    int seed = 1;
+    vector<string> args;
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--word_map=", 11) == 0) {
+            word_map_path = argv[i] + 11;
+        } else if (strncmp(argv[i], "--num_rows=", 11) == 0) {
+            num_rows = atoi(argv[i] + 11);
+        } else if (strncmp(argv[i], "--name=", 7) == 0) {
+            name = argv[i] + 7;
+        } else if (strncmp(argv[i], "--threads=", 10) == 0) {
+            num_threads = atoi(argv[i] + 10);
+        } else if (strncmp(argv[i], "--seed=", 7) == 0) {
+            seed = atoi(argv[i] + 7);
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    if (args.size() != 2) {
+        fprintf(stderr, "Usage: %s [--word_map=<map>] [--num_rows=<n>] [--name=<array>] "
+                "[--threads=<n>] [--seed=<n>] <word vectors> <output .params file>\n",
+                argv[0]);
+        return 1;
+    }
+    if (num_threads <= 0) num_threads = std::thread::hardware_concurrency();
+    if (num_threads <= 0) num_threads = 1;
+
+    const auto start = std::chrono::steady_clock::now();
+    TermFrequencyMap word_map(word_map_path, 0, 0);
+    if (num_rows <= 0) num_rows = word_map.Size() + 3;
+    WordEmbeddings embeddings;
+    LoadWordEmbeddings(args[0], word_map, num_rows, seed, num_threads, &embeddings);
+    const double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    LOG(INFO) << "Found vectors of dimension " << embeddings.dim << " for "
+              << embeddings.num_found << " of " << word_map.Size() << " words in "
+              << seconds << " s.";
+
+    GreedyNetwork::Parameter matrix;
+    matrix.name = name;
+    matrix.shape = {static_cast<uint32_t>(embeddings.num_rows),
+                    static_cast<uint32_t>(embeddings.dim)};
+    matrix.values = std::move(embeddings.values);
+    GreedyNetwork::SaveParameters(args[1], {matrix});
+    return 0;
+}
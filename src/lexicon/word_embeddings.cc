@@ -0,0 +1,173 @@
+#include "word_embeddings.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <random>
+#include <thread>
+
+#include "../utils/mapped_file.h"
+#include "term_frequency_map.h"
+
+namespace {
+
+// A vector of the file to parse: the text after the word and the row it
+// goes to.
+struct TextVector {
+    int row;
+    const char *begin;
+    const char *end;
+};
+
+// Returns the end of the line that starts at begin.
+const char *LineEnd(const char *begin, const char *end) {
+    const char *newline = static_cast<const char *>(memchr(begin, '\n', end - begin));
+    return newline == nullptr ? end : newline;
+}
+
+// Returns the whitespace separated fields of a line.
+vector<StringPiece> Fields(const char *begin, const char *end) {
+    vector<StringPiece> fields;
+    while (begin < end) {
+        while (begin < end && isspace(static_cast<unsigned char>(*begin))) ++begin;
+        const char *field = begin;
+        while (begin < end && !isspace(static_cast<unsigned char>(*begin))) ++begin;
+        if (begin > field) fields.emplace_back(field, begin - field);
+    }
+    return fields;
+}
+
+// Returns true for "<words> <dimension>" and sets the dimension.
+bool ParseHeader(const vector<StringPiece> &fields, int *dim) {
+    if (fields.size() != 2) return false;
+    for (const StringPiece &field : fields) {
+        for (size_t i = 0; i < field.size(); ++i) {
+            if (!isdigit(static_cast<unsigned char>(field[i]))) return false;
+        }
+    }
+    *dim = atoi(fields[1].ToString().c_str());
+    return *dim > 0;
+}
+
+// Parses the dim floats of a text vector into its row. strtof() needs text
+// that ends within the mapping, so a last line without a newline is copied.
+void ParseTextVector(const TextVector &vector, const MappedFile &file,
+                     WordEmbeddings *embeddings) {
+    string copy;
+    const char *text = vector.begin;
+    const char *end = vector.end;
+    if (end == file.data() + file.size()) {
+        copy.assign(vector.begin, vector.end);
+        text = copy.c_str();
+        end = text + copy.size();
+    }
+    float *row = embeddings->row(vector.row);
+    for (int i = 0; i < embeddings->dim; ++i) {
+        char *next = nullptr;
+        row[i] = strtof(text, &next);
+        CHECK(next != text && next <= end)
+            << file.filename() << ": vector with fewer than " << embeddings->dim
+            << " values.";
+        text = next;
+    }
+}
+
+// Looks up the words of a text file and parses the vectors of the terms in
+// parallel.
+void LoadText(const MappedFile &file, const TermFrequencyMap &terms,
+              int num_threads, vector<bool> *found, WordEmbeddings *embeddings) {
+    const char *begin = file.data();
+    const char *end = begin + file.size();
+    const char *line_end = LineEnd(begin, end);
+    const vector<StringPiece> first = Fields(begin, line_end);
+    CHECK(!first.empty()) << file.filename() << " has no word vectors.";
+    if (ParseHeader(first, &embeddings->dim)) {
+        begin = line_end + (line_end < end);
+    } else {
+        embeddings->dim = first.size() - 1;
+    }
+    CHECK_GT(embeddings->dim, 0) << file.filename() << " has no word vectors.";
+
+    vector<TextVector> vectors;
+    while (begin < end) {
+        line_end = LineEnd(begin, end);
+        const char *word_end = begin;
+        while (word_end < line_end && *word_end != ' ' && *word_end != '\t') ++word_end;
+        const int index = terms.LookupIndex(StringPiece(begin, word_end - begin), -1);
+        if (index >= 0 && !(*found)[index]) {
+            (*found)[index] = true;
+            vectors.push_back({index, word_end, line_end});
+        }
+        begin = line_end + 1;
+    }
+
+    embeddings->values.resize(static_cast<size_t>(embeddings->num_rows) * embeddings->dim);
+    vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            for (size_t i = t; i < vectors.size(); i += num_threads) {
+                ParseTextVector(vectors[i], file, embeddings);
+            }
+        });
+    }
+    for (std::thread &thread : threads) thread.join();
+}
+
+// Looks up the words of a binary file and copies the vectors of the terms.
+void LoadBinary(const MappedFile &file, const TermFrequencyMap &terms,
+                vector<bool> *found, WordEmbeddings *embeddings) {
+    const char *begin = file.data();
+    const char *end = begin + file.size();
+    const char *line_end = LineEnd(begin, end);
+    CHECK(ParseHeader(Fields(begin, line_end), &embeddings->dim))
+        << file.filename() << " has no \"<words> <dimension>\" header.";
+    begin = line_end + 1;
+
+    const size_t vector_size = embeddings->dim * sizeof(float);
+    embeddings->values.resize(static_cast<size_t>(embeddings->num_rows) * embeddings->dim);
+    while (true) {
+        // Words follow the previous vector, after a newline in some files.
+        while (begin < end && isspace(static_cast<unsigned char>(*begin))) ++begin;
+        if (begin == end) break;
+        const char *word_end = static_cast<const char *>(memchr(begin, ' ', end - begin));
+        CHECK(word_end != nullptr && end - word_end > static_cast<ptrdiff_t>(vector_size))
+            << file.filename() << ": truncated vector.";
+        const int index = terms.LookupIndex(StringPiece(begin, word_end - begin), -1);
+        if (index >= 0 && !(*found)[index]) {
+            (*found)[index] = true;
+            memcpy(embeddings->row(index), word_end + 1, vector_size);
+        }
+        begin = word_end + 1 + vector_size;
+    }
+}
+
+}  // namespace
+
+void LoadWordEmbeddings(const string &path, const TermFrequencyMap &terms,
+                        int num_rows, uint32_t seed, int num_threads,
+                        WordEmbeddings *embeddings) {
+    CHECK_GE(num_rows, terms.Size());
+    embeddings->num_rows = num_rows;
+    MappedFile file(path);
+    vector<bool> found(num_rows, false);
+    const bool binary = path.size() >= 4 && path.compare(path.size() - 4, 4, ".bin") == 0;
+    if (binary) {
+        LoadBinary(file, terms, &found, embeddings);
+    } else {
+        LoadText(file, terms, std::max(num_threads, 1), &found, embeddings);
+    }
+
+    std::mt19937 random(seed);
+    std::normal_distribution<float> normal(0, 1 / sqrt(embeddings->dim));
+    embeddings->num_found = 0;
+    for (int r = 0; r < num_rows; ++r) {
+        if (found[r]) {
+            ++embeddings->num_found;
+            continue;
+        }
+        float *row = embeddings->row(r);
+        for (int i = 0; i < embeddings->dim; ++i) row[i] = normal(random);
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef SYNTAXNET_WORD_EMBEDDINGS_H
+#define SYNTAXNET_WORD_EMBEDDINGS_H
+
+#include "../base.h"
+
+class TermFrequencyMap;
+
+/*!
+ * \brief Pretrained word vectors aligned to a term map: a row-major matrix
+ * whose row i is the vector of term i of the map.
+ *
+ * Vectors are read from a file in the word2vec text format, which fastText
+ * also writes to .vec files, or in the word2vec binary format for files
+ * ending in ".bin". The file is mapped and read in one pass: the words are
+ * looked up in the map in file order, the first vector of a word wins, and
+ * the text of the vectors that are kept is parsed into floats by
+ * num_threads threads. A text file may lack the "<words> <dimension>"
+ * header line, as GloVe files do.
+ *
+ * The rows of terms without a vector and the rows past the terms, e.g. the
+ * feature ids for unknown words, are drawn from a normal distribution with
+ * a standard deviation of 1 / sqrt(dimension).
+ */
+struct WordEmbeddings {
+    int num_rows = 0;
+    int dim = 0;
+    vector<float> values;
+
+    // Number of terms that got a pretrained vector.
+    int num_found = 0;
+
+    float *row(int r) { return values.data() + static_cast<size_t>(r) * dim; }
+};
+
+// Reads the vectors of path for the terms of the map into num_rows rows,
+// at least as many as the map has terms.
+void LoadWordEmbeddings(const string &path, const TermFrequencyMap &terms,
+                        int num_rows, uint32_t seed, int num_threads,
+                        WordEmbeddings *embeddings);
+
+#endif //SYNTAXNET_WORD_EMBEDDINGS_H
@@ -0,0 +1,128 @@
+#include "greedy_network.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+
+#include "../../dmlc-core/include/dmlc/io.h"
+
+namespace {
+
+// Header of mxnet's NDArray list files (kMXAPINDArrayListMagic).
+const uint64_t kNDArrayListMagic = 0x112;
+
+// Device and type of the saved arrays: CPU memory, float32.
+const int32_t kCPUDevice = 1;
+const int32_t kFloat32 = 0;
+
+}  // namespace
+
+GreedyNetwork::GreedyNetwork(const Spec &spec) : spec_(spec) {
+    CHECK_EQ(spec.num_features.size(), spec.num_feature_ids.size());
+    CHECK_EQ(spec.num_features.size(), spec.embedding_dims.size());
+    CHECK_GT(spec.num_actions, 0);
+
+    // Names as GreedyParser._BuildNetwork() declares the variables.
+    for (int g = 0; g < num_groups(); ++g) {
+        parameters_.push_back({std::to_string(g) + "_embed_weight",
+                               {static_cast<uint32_t>(spec.num_feature_ids[g]),
+                                static_cast<uint32_t>(spec.embedding_dims[g])}, {}});
+        input_size_ += spec.num_features[g] * spec.embedding_dims[g];
+        num_feature_ids_ += spec.num_features[g];
+    }
+    int layer_input_size = input_size_;
+    for (int l = 0; l < num_layers(); ++l) {
+        const bool softmax = l + 1 == num_layers();
+        const string prefix = softmax ? "softmax" : "t_" + std::to_string(l) + "_i2h";
+        const uint32_t size = softmax ? spec.num_actions : spec.hidden_layer_sizes[l];
+        parameters_.push_back({prefix + "_weight",
+                               {size, static_cast<uint32_t>(layer_input_size)}, {}});
+        parameters_.push_back({prefix + "_bias", {size}, {}});
+        layer_input_size = size;
+    }
+    for (Parameter &parameter : parameters_) {
+        parameter.values.assign(static_cast<size_t>(parameter.rows()) * parameter.cols(), 0);
+    }
+}
+
+void GreedyNetwork::InitializeUniform(float scale, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> uniform(-scale, scale);
+    for (Parameter &parameter : parameters_) {
+        const bool is_bias = parameter.shape.size() == 1;
+        for (float &value : parameter.values) value = is_bias ? 0 : uniform(rng);
+    }
+}
+
+void GreedyNetwork::InitActivations(Activations *activations) const {
+    activations->layers.resize(num_layers() + 1);
+    activations->layers[0].resize(input_size_);
+    for (int l = 0; l < num_layers(); ++l) {
+        activations->layers[l + 1].resize(weights(l).rows());
+    }
+}
+
+void GreedyNetwork::Forward(const int32_t *feature_ids,
+                            Activations *activations) const {
+    // Concatenated embeddings.
+    float *input = activations->layer(0);
+    for (int g = 0; g < num_groups(); ++g) {
+        const Parameter &matrix = embedding(g);
+        const int dims = matrix.cols();
+        for (int f = 0; f < spec_.num_features[g]; ++f, ++feature_ids) {
+            const int32_t id = *feature_ids;
+            DCHECK_LT(id, matrix.rows());
+            if (id >= 0) {
+                std::copy(matrix.row(id), matrix.row(id) + dims, input);
+            } else {
+                std::fill(input, input + dims, 0.0f);
+            }
+            input += dims;
+        }
+    }
+
+    // Fully connected layers, ReLU but for the last one.
+    for (int l = 0; l < num_layers(); ++l) {
+        const Parameter &matrix = weights(l);
+        const float *b = bias(l).values.data();
+        const float *x = activations->layer(l);
+        float *y = activations->layer(l + 1);
+        const int cols = matrix.cols();
+        for (int r = 0; r < matrix.rows(); ++r) {
+            const float *w = matrix.row(r);
+            float sum = b[r];
+            for (int c = 0; c < cols; ++c) sum += w[c] * x[c];
+            y[r] = l + 1 < num_layers() ? std::max(sum, 0.0f) : sum;
+        }
+    }
+}
+
+void GreedyNetwork::Save(const string &path) const {
+    SaveParameters(path, parameters_);
+}
+
+void GreedyNetwork::SaveParameters(const string &path,
+                                   const vector<Parameter> &parameters) {
+    std::unique_ptr<dmlc::Stream> stream(dmlc::Stream::Create(path.c_str(), "w"));
+    const uint64_t reserved = 0;
+    const uint64_t num_arrays = parameters.size();
+    stream->Write(&kNDArrayListMagic, sizeof(kNDArrayListMagic));
+    stream->Write(&reserved, sizeof(reserved));
+
+    // NDArray::Save(): the shape as a uint32 rank and dimensions, the
+    // context, the type flag and the data.
+    stream->Write(&num_arrays, sizeof(num_arrays));
+    vector<string> names;
+    for (const Parameter &parameter : parameters) {
+        const uint32_t ndim = parameter.shape.size();
+        stream->Write(&ndim, sizeof(ndim));
+        stream->Write(parameter.shape.data(), ndim * sizeof(uint32_t));
+        const int32_t device_id = 0;
+        stream->Write(&kCPUDevice, sizeof(kCPUDevice));
+        stream->Write(&device_id, sizeof(device_id));
+        stream->Write(&kFloat32, sizeof(kFloat32));
+        stream->Write(parameter.values.data(), parameter.values.size() * sizeof(float));
+        names.push_back("arg:" + parameter.name);
+    }
+    stream->Write(names);
+}
@@ -0,0 +1,121 @@
+#ifndef SYNTAXNET_GREEDY_NETWORK_H
+#define SYNTAXNET_GREEDY_NETWORK_H
+
+#include "../base.h"
+
+/*!
+ * \brief Parameters and forward pass of the greedy parser network built by
+ * GreedyParser in mxnet/graph_builder.py: an embedding matrix per feature
+ * group, whose rows for the feature ids of a state are concatenated, ReLU
+ * hidden layers and a softmax layer over the parser actions.
+ *
+ * Parameters are kept in mxnet's argument order, names and shapes, e.g.
+ * (outputs, inputs) row-major for fully connected weights, so Save() can
+ * write them as an mxnet .params file that the scorer in model_predict.cc
+ * loads together with graph_builder.py's symbol for the same sizes.
+ */
+class GreedyNetwork {
+public:
+    struct Spec {
+        // Per feature group: features of a state, ids of the feature space
+        // and embedding size.
+        vector<int> num_features;
+        vector<int> num_feature_ids;
+        vector<int> embedding_dims;
+
+        // Sizes of the ReLU layers.
+        vector<int> hidden_layer_sizes;
+
+        int num_actions = 0;
+    };
+
+    /*!
+     * \brief A named tensor of at most two dimensions, stored row-major.
+     */
+    struct Parameter {
+        string name;
+        vector<uint32_t> shape;
+        vector<float> values;
+
+        int rows() const { return shape[0]; }
+        int cols() const { return shape.size() > 1 ? shape[1] : 1; }
+        float *row(int r) { return values.data() + static_cast<size_t>(r) * cols(); }
+        const float *row(int r) const {
+            return values.data() + static_cast<size_t>(r) * cols();
+        }
+    };
+
+    /*!
+     * \brief Inputs and outputs of the layers for one state: layer(0) is the
+     * concatenated embeddings, layer(l + 1) the output of fully connected
+     * layer l, after the ReLU for hidden layers and before the softmax for
+     * the last one.
+     */
+    struct Activations {
+        vector<vector<float>> layers;
+
+        float *layer(int l) { return layers[l].data(); }
+        const float *layer(int l) const { return layers[l].data(); }
+    };
+
+    // Creates zero parameters of the given sizes.
+    explicit GreedyNetwork(const Spec &spec);
+
+    // Draws the weights uniformly from [-scale, scale] and zeroes the
+    // biases, like mx.initializer.Uniform.
+    void InitializeUniform(float scale, uint32_t seed);
+
+    // Computes the activations for one state. feature_ids holds the ids of
+    // each group in turn, as written by example_exporter; ids of features
+    // that do not fire (negative) contribute zero embeddings.
+    void Forward(const int32_t *feature_ids, Activations *activations) const;
+
+    // Sizes the activations for this network.
+    void InitActivations(Activations *activations) const;
+
+    // Writes the parameters as an mxnet NDArray list, each named
+    // "arg:<name>".
+    void Save(const string &path) const;
+
+    // Writes any parameters like Save(), e.g. a single embedding matrix.
+    static void SaveParameters(const string &path, const vector<Parameter> &parameters);
+
+    const Spec &spec() const { return spec_; }
+
+    int num_groups() const { return spec_.num_features.size(); }
+
+    // Fully connected layers, the hidden layers and the softmax layer.
+    int num_layers() const { return spec_.hidden_layer_sizes.size() + 1; }
+
+    // Size of the concatenated embeddings.
+    int input_size() const { return input_size_; }
+
+    // Size of the feature id rows of Forward().
+    int num_feature_ids() const { return num_feature_ids_; }
+
+    vector<Parameter> &parameters() { return parameters_; }
+    const vector<Parameter> &parameters() const { return parameters_; }
+
+    Parameter *embedding(int group) { return &parameters_[group]; }
+    const Parameter &embedding(int group) const { return parameters_[group]; }
+
+    Parameter *weights(int layer) { return &parameters_[num_groups() + 2 * layer]; }
+    const Parameter &weights(int layer) const {
+        return parameters_[num_groups() + 2 * layer];
+    }
+
+    Parameter *bias(int layer) { return &parameters_[num_groups() + 2 * layer + 1]; }
+    const Parameter &bias(int layer) const {
+        return parameters_[num_groups() + 2 * layer + 1];
+    }
+
+private:
+    Spec spec_;
+    int input_size_ = 0;
+    int num_feature_ids_ = 0;
+
+    // Embeddings of each group, then the weights and bias of each layer.
+    vector<Parameter> parameters_;
+};
+
+#endif //SYNTAXNET_GREEDY_NETWORK_H
@@ -0,0 +1,538 @@
+/*!
+ * \brief Trains the greedy parser network of mxnet/graph_builder.py on the
+ * CPU, on examples made by the gold oracle of a transition system as it walks
+ * the corpus, and writes the weights as an mxnet .params file for the scorer.
+ *
+ * Usage (from the directory holding word-map, tag-map and label-map):
+ *
+ *   greedy_trainer [--resource_dir=.] [--spec=src/parser_features.fml]
+ *                  [--threads=0] [--epochs=10] [--batch_size=32]
+ *                  [--hidden_layer_sizes=200,200] [--optimizer=momentum]
+ *                  [--learning_rate=0.1] [--momentum=0.9]
+ *                  [--weight_decay=1e-4] [--max_grad_norm=5]
+ *                  [--decay_steps=4000] [--decay_rate=0.96] [--seed=1]
+ *                  [--word_embeddings=<word vectors>]
+ *                  [--transition_system=arc-standard]
+ *                  <corpus pattern>... <output .params file>
+ *
+ * Each thread (all cores with 0) walks its own shard of the corpus every
+ * epoch and trains on mini-batches of the examples of consecutive states.
+ * Threads update the shared weights Hogwild style, without locks: every
+ * fully connected layer, but only the embedding rows a batch looks up.
+ * --optimizer is "momentum" (SGD with momentum, like graph_builder.py) or
+ * "adagrad". The learning rate decays by decay_rate every decay_steps
+ * batches, counted over all threads.
+ *
+ * With --word_embeddings, the word embeddings start from the pretrained
+ * vectors of a word2vec text or binary file (see word_embeddings.h), whose
+ * dimension must be that of the word embeddings.
+ *
+ * --transition_system names a registered transition system, e.g.
+ * "arc-standard" or "arc-swift", whose actions the network predicts.
+ *
+ * The saved weights are named and shaped like graph_builder.py's, so they
+ * load with the symbol it saves for the same hidden layer sizes.
+ */
+#include <math.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+#include "../feature/embedding_feature_extractor.h"
+#include "../io/text_reader.h"
+#include "../lexicon/word_embeddings.h"
+#include "../parser/parser_state.h"
+#include "../parser/parser_transitions.h"
+#include "../utils/shared_store.h"
+#include "greedy_network.h"
+
+namespace {
+
+typedef GreedyNetwork::Parameter Parameter;
+
+// Reads a whole file into a string.
+string ReadFile(const string &path) {
+    std::ifstream file(path);
+    CHECK(file) << "Cannot read " << path;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+// Adds an input with a single file to the task context.
+void AddInput(const string &name, const string &file, TaskContext *context) {
+    TaskInput *input = context->mutable_spec()->add_input();
+    input->set_name(name);
+    input->add_part()->set_file_pattern(file);
+}
+
+// Sets *value to the value of arg if it is --<name>=<value>.
+bool ParseFlag(const char *arg, const string &name, string *value) {
+    const string prefix = "--" + name + "=";
+    if (strncmp(arg, prefix.c_str(), prefix.size()) != 0) return false;
+    *value = arg + prefix.size();
+    return true;
+}
+
+struct TrainerOptions {
+    int epochs = 10;
+    int batch_size = 32;
+    bool adagrad = false;
+    float learning_rate = 0.1;
+    float momentum = 0.9;
+    float weight_decay = 1e-4;
+    float max_grad_norm = 5.0;
+    int decay_steps = 4000;
+    float decay_rate = 0.96;
+
+    // Initial AdaGrad accumulator, which bounds the first steps.
+    float adagrad_initial_value = 0.1;
+};
+
+/*!
+ * \brief The weights shared by all threads and the optimizer state, a
+ * momentum or AdaGrad accumulator per weight.
+ */
+class SharedModel {
+public:
+    SharedModel(const GreedyNetwork::Spec &spec, const TrainerOptions &options)
+        : network_(spec), slots_(spec), options_(options) {
+        if (options.adagrad) {
+            for (Parameter &slot : slots_.parameters()) {
+                std::fill(slot.values.begin(), slot.values.end(),
+                          options.adagrad_initial_value);
+            }
+        }
+    }
+
+    GreedyNetwork *network() { return &network_; }
+
+    // Counts a batch and returns the learning rate for it.
+    float NextLearningRate() {
+        const int64_t step = step_++;
+        return options_.learning_rate *
+               pow(options_.decay_rate, static_cast<double>(step / options_.decay_steps));
+    }
+
+    /*!
+     * \brief Applies scale * gradient, plus weight decay, to size weights
+     * from offset on in parameter index. Other threads may update the same
+     * weights at the same time; with sparse updates, collisions are rare
+     * and only lose part of a step.
+     */
+    void Update(int index, size_t offset, size_t size, const float *gradient,
+                float scale, float learning_rate) {
+        float *weights = network_.parameters()[index].values.data() + offset;
+        float *slot = slots_.parameters()[index].values.data() + offset;
+        const float decay = options_.weight_decay;
+        if (options_.adagrad) {
+            for (size_t i = 0; i < size; ++i) {
+                const float g = scale * gradient[i] + decay * weights[i];
+                slot[i] += g * g;
+                weights[i] -= learning_rate * g / sqrtf(slot[i]);
+            }
+        } else {
+            const float momentum = options_.momentum;
+            for (size_t i = 0; i < size; ++i) {
+                const float g = scale * gradient[i] + decay * weights[i];
+                slot[i] = momentum * slot[i] - learning_rate * g;
+                weights[i] += slot[i];
+            }
+        }
+    }
+
+private:
+    GreedyNetwork network_;
+    GreedyNetwork slots_;
+    TrainerOptions options_;
+
+    // Batches trained so far by all threads.
+    std::atomic<int64_t> step_{0};
+};
+
+/*!
+ * \brief Feature extraction, oracle and gradients of one thread, which
+ * trains on one shard of the corpus.
+ */
+class Worker {
+public:
+    Worker(TaskContext *context, const TaskInput &corpus, int shard, int num_shards,
+           const TermFrequencyMap *label_map, SharedModel *model,
+           const TrainerOptions &options)
+        : reader_(corpus, 0, shard, num_shards), label_map_(label_map),
+          model_(model), network_(*model->network()), options_(options),
+          gradients_(network_.spec()) {
+        features_.Setup(context);
+        transition_system_.reset(ParserTransitionSystem::Create(
+            context->Get("parser_transition_system", "arc-standard")));
+        transition_system_->Setup(context);
+        features_.Init(context);
+        transition_system_->Init(context);
+        features_.RequestWorkspaces(&registry_);
+        activations_.resize(options.batch_size);
+        for (auto &activations : activations_) network_.InitActivations(&activations);
+        touched_.resize(network_.num_groups());
+        is_touched_.resize(network_.num_groups());
+        for (int g = 0; g < network_.num_groups(); ++g) {
+            is_touched_[g].assign(network_.embedding(g).rows(), false);
+        }
+        feature_vectors_.resize(features_.NumEmbeddings());
+    }
+
+    // Trains on every example of the shard once.
+    void RunEpoch() {
+        loss_ = 0;
+        num_correct_ = 0;
+        num_examples_ = 0;
+        const int row_size = network_.num_feature_ids();
+        for (Sentence *sentence = reader_.Read(); sentence != nullptr;
+             sentence = reader_.Read()) {
+            ParserState state(sentence, transition_system_->NewTransitionState(true),
+                              label_map_);
+            workspace_.Reset(registry_);
+            features_.Preprocess(&workspace_, &state);
+            while (!transition_system_->IsFinalState(state)) {
+                const ParserAction action = transition_system_->GetNextGoldAction(state);
+                features_.ExtractFeatureIds(workspace_, state, &feature_vectors_,
+                                            &feature_ids_);
+                for (const FeatureIds &ids : feature_ids_) {
+                    batch_ids_.insert(batch_ids_.end(), ids.data(), ids.data() + ids.size());
+                }
+                DCHECK_EQ(batch_ids_.size() % row_size, 0);
+                batch_labels_.push_back(action);
+                if (static_cast<int>(batch_labels_.size()) == options_.batch_size) {
+                    TrainBatch();
+                }
+                transition_system_->PerformActionWithoutHistory(action, &state);
+            }
+            reader_.Release(sentence);
+        }
+        if (!batch_labels_.empty()) TrainBatch();
+        reader_.Reset();
+    }
+
+    double loss() const { return loss_; }
+    int64_t num_correct() const { return num_correct_; }
+    int64_t num_examples() const { return num_examples_; }
+
+private:
+    // Back-propagates the softmax cross-entropy of the batch, averaged over
+    // its examples, and updates the shared weights.
+    void TrainBatch() {
+        const int batch_size = batch_labels_.size();
+        const int row_size = network_.num_feature_ids();
+        const int num_layers = network_.num_layers();
+        for (int b = 0; b < batch_size; ++b) {
+            GreedyNetwork::Activations &activations = activations_[b];
+            network_.Forward(batch_ids_.data() + b * row_size, &activations);
+
+            // Softmax, and its gradient wrt the logits.
+            const int num_actions = network_.spec().num_actions;
+            const int label = batch_labels_[b];
+            delta_.assign(activations.layer(num_layers),
+                          activations.layer(num_layers) + num_actions);
+            const float max_logit = *std::max_element(delta_.begin(), delta_.end());
+            float sum = 0;
+            for (float &value : delta_) sum += value = expf(value - max_logit);
+            for (float &value : delta_) value /= sum;
+            loss_ -= log(std::max(delta_[label], 1e-30f));
+            if (std::max_element(delta_.begin(), delta_.end()) - delta_.begin() == label) {
+                ++num_correct_;
+            }
+            delta_[label] -= 1;
+            for (float &value : delta_) value /= batch_size;
+
+            // Fully connected layers, from the top.
+            for (int l = num_layers - 1; l >= 0; --l) {
+                const Parameter &weights = network_.weights(l);
+                Parameter *weight_gradient = gradients_.weights(l);
+                float *bias_gradient = gradients_.bias(l)->values.data();
+                const float *input = activations.layer(l);
+                const int cols = weights.cols();
+                input_delta_.assign(cols, 0.0f);
+                for (int r = 0; r < weights.rows(); ++r) {
+                    const float d = delta_[r];
+                    if (d == 0) continue;
+                    bias_gradient[r] += d;
+                    float *gradient_row = weight_gradient->row(r);
+                    const float *weight_row = weights.row(r);
+                    for (int c = 0; c < cols; ++c) {
+                        gradient_row[c] += d * input[c];
+                        input_delta_[c] += d * weight_row[c];
+                    }
+                }
+
+                // Through the ReLU of the layer below.
+                if (l > 0) {
+                    for (int c = 0; c < cols; ++c) {
+                        if (input[c] <= 0) input_delta_[c] = 0;
+                    }
+                }
+                delta_.swap(input_delta_);
+            }
+
+            // Embedding rows.
+            const int32_t *ids = batch_ids_.data() + b * row_size;
+            const float *input_delta = delta_.data();
+            for (int g = 0; g < network_.num_groups(); ++g) {
+                Parameter *embedding_gradient = gradients_.embedding(g);
+                const int dims = embedding_gradient->cols();
+                for (int f = 0; f < network_.spec().num_features[g]; ++f) {
+                    const int32_t id = *ids++;
+                    if (id >= 0) {
+                        float *gradient_row = embedding_gradient->row(id);
+                        for (int c = 0; c < dims; ++c) gradient_row[c] += input_delta[c];
+                        if (!is_touched_[g][id]) {
+                            is_touched_[g][id] = true;
+                            touched_[g].push_back(id);
+                        }
+                    }
+                    input_delta += dims;
+                }
+            }
+        }
+        num_examples_ += batch_size;
+        ApplyGradients();
+        batch_ids_.clear();
+        batch_labels_.clear();
+    }
+
+    // Clips the gradients of the batch to max_grad_norm, applies them to
+    // the shared model and zeroes them.
+    void ApplyGradients() {
+        const int num_groups = network_.num_groups();
+        vector<Parameter> &gradients = gradients_.parameters();
+        double squared_norm = 0;
+        for (int g = 0; g < num_groups; ++g) {
+            const Parameter &gradient = gradients[g];
+            for (int32_t id : touched_[g]) {
+                const float *row = gradient.row(id);
+                for (int c = 0; c < gradient.cols(); ++c) squared_norm += row[c] * row[c];
+            }
+        }
+        for (size_t i = num_groups; i < gradients.size(); ++i) {
+            for (float value : gradients[i].values) squared_norm += value * value;
+        }
+        const double norm = sqrt(squared_norm);
+        const float scale = norm > options_.max_grad_norm ? options_.max_grad_norm / norm : 1;
+
+        const float learning_rate = model_->NextLearningRate();
+        for (int g = 0; g < num_groups; ++g) {
+            Parameter *gradient = &gradients[g];
+            const int dims = gradient->cols();
+            for (int32_t id : touched_[g]) {
+                float *row = gradient->row(id);
+                model_->Update(g, static_cast<size_t>(id) * dims, dims, row, scale,
+                               learning_rate);
+                std::fill(row, row + dims, 0.0f);
+                is_touched_[g][id] = false;
+            }
+            touched_[g].clear();
+        }
+        for (size_t i = num_groups; i < gradients.size(); ++i) {
+            vector<float> &values = gradients[i].values;
+            model_->Update(i, 0, values.size(), values.data(), scale, learning_rate);
+            std::fill(values.begin(), values.end(), 0.0f);
+        }
+    }
+
+    ParserEmbeddingFeatureExtractor features_{"parser"};
+    std::unique_ptr<ParserTransitionSystem> transition_system_;
+    WorkspaceRegistry registry_;
+    WorkspaceSet workspace_;
+    vector<FeatureVector> feature_vectors_;
+    vector<FeatureIds> feature_ids_;
+    TextReader reader_;
+    const TermFrequencyMap *label_map_;
+
+    SharedModel *model_;
+    const GreedyNetwork &network_;
+    TrainerOptions options_;
+
+    // Feature id rows and gold actions of the batch.
+    vector<int32_t> batch_ids_;
+    vector<int32_t> batch_labels_;
+    vector<GreedyNetwork::Activations> activations_;
+
+    // Gradients of the batch, dense but for the embeddings, of which only
+    // the touched rows are nonzero.
+    GreedyNetwork gradients_;
+    vector<vector<int32_t>> touched_;
+    vector<vector<bool>> is_touched_;
+
+    // Gradients wrt the output and input of a layer.
+    vector<float> delta_;
+    vector<float> input_delta_;
+
+    double loss_ = 0;
+    int64_t num_correct_ = 0;
+    int64_t num_examples_ = 0;
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    string resource_dir = ".";
+    string spec_file = "src/parser_features.fml";
+    string hidden_layer_sizes = "200,200";
+    string optimizer = "momentum";
+    int num_threads = 0;
+    int seed = 1;
+    string word_embeddings;
+    string transition_system_name = "arc-standard";
+    TrainerOptions options;
+    vector<string> args;
+    for (int i = 1; i < argc; ++i) {
+        string value;
+        if (ParseFlag(argv[i], "resource_dir", &value)) {
+            resource_dir = value;
+        } else if (ParseFlag(argv[i], "spec", &value)) {
+            spec_file = value;
+        } else if (ParseFlag(argv[i], "threads", &value)) {
+            num_threads = atoi(value.c_str());
+        } else if (ParseFlag(argv[i], "epochs", &value)) {
+            options.epochs = atoi(value.c_str());
+        } else if (ParseFlag(argv[i], "batch_size", &value)) {
+            options.batch_size = atoi(value.c_str());
+        } else if (ParseFlag(argv[i], "hidden_layer_sizes", &value)) {
+            hidden_layer_sizes = value;
+        } else if (ParseFlag(argv[i], "optimizer", &value)) {
+            optimizer = value;
+        } else if (ParseFlag(argv[i], "learning_rate", &value)) {
+            options.learning_rate = atof(value.c_str());
+        } else if (ParseFlag(argv[i], "momentum", &value)) {
+            options.momentum = atof(value.c_str());
+        } else if (ParseFlag(argv[i], "weight_decay", &value)) {
+            options.weight_decay = atof(value.c_str());
+        } else if (ParseFlag(argv[i], "max_grad_norm", &value)) {
+            options.max_grad_norm = atof(value.c_str());
+        } else if (ParseFlag(argv[i], "decay_steps", &value)) {
+            options.decay_steps = atoi(value.c_str());
+        } else if (ParseFlag(argv[i], "decay_rate", &value)) {
+            options.decay_rate = atof(value.c_str());
+        } else if (ParseFlag(argv[i], "seed", &value)) {
+            seed = atoi(value.c_str());
+        } else if (ParseFlag(argv[i], "word_embeddings", &value)) {
+            word_embeddings = value;
+        } else if (ParseFlag(argv[i], "transition_system", &value)) {
+            transition_system_name = value;
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    if (args.size() < 2) {
+        fprintf(stderr, "Usage: %s [--<flag>=<value>]... <corpus pattern>... "
+                "<output .params file>\n", argv[0]);
+        return 1;
+    }
+    CHECK(optimizer == "momentum" || optimizer == "adagrad")
+        << "Unknown optimizer " << optimizer;
+    options.adagrad = optimizer == "adagrad";
+    CHECK_GT(options.batch_size, 0);
+    CHECK_GT(options.decay_steps, 0);
+    if (num_threads <= 0) num_threads = std::thread::hardware_concurrency();
+    if (num_threads <= 0) num_threads = 1;
+
+    // The feature spec as the parser uses it, without newlines.
+    string spec = ReadFile(spec_file);
+    for (char &c : spec) {
+        if (c == '\n') c = ' ';
+    }
+    TaskContext context;
+    AddInput("word-map", resource_dir + "/word-map", &context);
+    AddInput("tag-map", resource_dir + "/tag-map", &context);
+    AddInput("label-map", resource_dir + "/label-map", &context);
+    context.SetParameter("parser_features", spec);
+    context.SetParameter("parser_embedding_names", "words;tags;labels");
+    context.SetParameter("parser_embedding_dims", "64;32;32");
+    context.SetParameter("parser_transition_system", transition_system_name);
+    TaskInput corpus;
+    for (size_t i = 0; i + 1 < args.size(); ++i) {
+        corpus.add_part()->set_file_pattern(args[i]);
+    }
+    const string &output_file = args.back();
+
+    const string label_map_path = resource_dir + "/label-map";
+    const TermFrequencyMap *label_map =
+        SharedStoreUtils::GetWithDefaultName<TermFrequencyMap>(label_map_path, 0, 0);
+
+    // Network sizes from the feature spec and the term maps.
+    GreedyNetwork::Spec network_spec;
+    {
+        ParserEmbeddingFeatureExtractor features("parser");
+        features.Setup(&context);
+        features.Init(&context);
+        for (int g = 0; g < features.NumEmbeddings(); ++g) {
+            network_spec.num_features.push_back(features.FeatureSize(g));
+            network_spec.num_feature_ids.push_back(features.EmbeddingSize(g));
+            network_spec.embedding_dims.push_back(features.EmbeddingDims(g));
+        }
+        std::unique_ptr<ParserTransitionSystem> transition_system(
+            ParserTransitionSystem::Create(transition_system_name));
+        transition_system->Init(&context);
+        network_spec.num_actions = transition_system->NumActions(label_map->Size());
+    }
+    for (const string &size : utils::Split(hidden_layer_sizes, ',')) {
+        network_spec.hidden_layer_sizes.push_back(atoi(size.c_str()));
+    }
+    SharedModel model(network_spec, options);
+    model.network()->InitializeUniform(0.2, seed);
+    if (!word_embeddings.empty()) {
+        // The words are the first feature group.
+        GreedyNetwork::Parameter *matrix = model.network()->embedding(0);
+        const string word_map_path = resource_dir + "/word-map";
+        const TermFrequencyMap *word_map =
+            SharedStoreUtils::GetWithDefaultName<TermFrequencyMap>(word_map_path, 0, 0);
+        WordEmbeddings pretrained;
+        LoadWordEmbeddings(word_embeddings, *word_map, matrix->rows(), seed, num_threads,
+                           &pretrained);
+        CHECK_EQ(pretrained.dim, matrix->cols())
+            << "The word vectors do not have the dimension of the word embeddings.";
+        matrix->values = std::move(pretrained.values);
+        LOG(INFO) << "Loaded pretrained vectors of " << pretrained.num_found << " of "
+                  << word_map->Size() << " words.";
+        SharedStore::Release(word_map);
+    }
+
+    // Set up the workers up front: the shared store is not thread-safe.
+    vector<std::unique_ptr<Worker>> workers;
+    for (int w = 0; w < num_threads; ++w) {
+        workers.emplace_back(new Worker(&context, corpus, w, num_threads, label_map,
+                                        &model, options));
+    }
+
+    LOG(INFO) << "Training on " << num_threads << " threads.";
+    for (int epoch = 0; epoch < options.epochs; ++epoch) {
+        const auto start = std::chrono::steady_clock::now();
+        vector<std::thread> threads;
+        for (auto &worker : workers) {
+            threads.emplace_back(&Worker::RunEpoch, worker.get());
+        }
+        double loss = 0;
+        int64_t num_correct = 0;
+        int64_t num_examples = 0;
+        for (int w = 0; w < num_threads; ++w) {
+            threads[w].join();
+            loss += workers[w]->loss();
+            num_correct += workers[w]->num_correct();
+            num_examples += workers[w]->num_examples();
+        }
+        const double seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+        LOG(INFO) << "Epoch " << epoch << ": loss " << loss / std::max<int64_t>(num_examples, 1)
+                  << ", training accuracy "
+                  << 100.0 * num_correct / std::max<int64_t>(num_examples, 1) << "%, "
+                  << num_examples / seconds << " examples/s.";
+    }
+
+    model.network()->Save(output_file);
+    LOG(INFO) << "Saved model " << output_file << ".";
+    workers.clear();
+    SharedStore::Release(label_map);
+    return 0;
+}
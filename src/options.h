@@ -10,6 +10,19 @@ struct Options {
   string tag_map_file_ = "tag-map";
   string category_map_file_ = "category-map";
   string label_map_file_ = "label-map";
+  string prefix_table_file_ = "prefix-table";
+  string suffix_table_file_ = "suffix-table";
+  int max_prefix_length_ = 3;
+  int max_suffix_length_ = 3;
+
+  // Threads counting terms in the lexicon builder; 0 uses all cores.
+  int lexicon_num_threads_ = 0;
+
+  // Terms that the lexicon builder keeps in memory before spilling counts
+  // to disk (0 never spills), and the prefix of the spill files, which
+  // defaults to the word map file name.
+  int64_t lexicon_max_terms_in_memory_ = 1 << 24;
+  string lexicon_spill_prefix_ = "";
 };
 
 #endif /* end of include guard: OPTIONS_H */
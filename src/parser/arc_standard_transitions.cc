@@ -12,6 +12,9 @@
  *  RIGHT_ARC: encoded as an even number starting from 2.
  */
 
+#include <algorithm>
+#include <functional>
+#include <limits>
 #include <string>
 
 #include "parser_state.h"
@@ -21,12 +24,68 @@ using namespace std;
 
 class ArcStandardTransitionState : public ParserTransitionState {
 public:
+    explicit ArcStandardTransitionState(bool training_mode)
+            : training_mode_(training_mode) {}
+
     ParserTransitionState *Clone() const override {
-        return new ArcStandardTransitionState();
+        return new ArcStandardTransitionState(*this);
     }
 
     // Pushes the root on the stack before using the parser state in parsing.
-    void Init(ParserState *state) override { state->Push(-1); }
+    // In training mode, also looks up the gold label of each token and counts
+    // the gold children of each token, so the oracle runs in constant time.
+    void Init(ParserState *state) override {
+        state->Push(-1);
+        if (!training_mode_) return;
+        const int num_tokens = state->NumTokens();
+        gold_labels_.resize(num_tokens);
+        pending_children_.assign(num_tokens + 1, 0);
+        for (int i = 0; i < num_tokens; ++i) {
+            gold_labels_[i] = state->GoldLabel(i);
+            ++pending_children_[state->GoldHead(i) + 1];
+        }
+    }
+
+    // Records that a token was attached to a head, right or wrong.
+    void Attach(const ParserState &state, int index) {
+        if (training_mode_) --pending_children_[state.GoldHead(index) + 1];
+    }
+
+    // Returns the gold label of a token.
+    int GoldLabel(const ParserState &state, int index) const {
+        return training_mode_ ? gold_labels_[index] : state.GoldLabel(index);
+    }
+
+    // Determines if a token has any gold children left without a head. For
+    // a projective gold tree and the top of the stack, these are the children
+    // to its right in the input.
+    bool HasPendingChildren(const ParserState &state, int head) const {
+        if (training_mode_) return pending_children_[head + 1] > 0;
+        return !DoneChildrenRightOf(state, head);
+    }
+
+    // Determines if a token has any children to the right in the sentence.
+    // Arc standard is a bottom-up parsing method and has to finish all sub-trees
+    // first.
+    static bool DoneChildrenRightOf(const ParserState &state, int head) {
+        int index = state.Next();
+        int num_tokens = state.sentence().token_size();
+        while (index < num_tokens) {
+            // Check if the token at index is the child of head.
+            int actual_head = state.GoldHead(index);
+            if (actual_head == head) return false;
+
+            // If the head of the token at index is to the right of it there cannot be
+            // any children in-between, so we can skip forward to the head. Note this
+            // is only true for projective trees.
+            if (actual_head > index) {
+                index = actual_head;
+            } else {
+                ++index;
+            }
+        }
+        return true;
+    }
 
     // Adds transition state specific annotations to the document.
     void AddParseToDocument(const ParserState &state, bool rewrite_root_labels,
@@ -55,24 +114,35 @@ public:
         string str;
         str.append("[");
         for (int i = state.StackSize() - 1; i >= 0; --i) {
-            const string &word = state.GetToken(state.Stack(i)).word();
+            const StringPiece word = state.GetToken(state.Stack(i)).word();
             if (i != state.StackSize() - 1) str.append(" ");
-            if (word == "") {
+            if (word.empty()) {
                 str.append(ParserState::kRootLabel);
             } else {
-                str.append(word);
+                str.append(word.data(), word.size());
             }
         }
         str.append("]");
         for (int i = state.Next(); i < state.NumTokens(); ++i) {
-            str.append(state.GetToken(i).word());
+            str.append(state.GetToken(i).word().ToString());
             str.append(" ");
         }
         return str;
     }
+
+private:
+    // Whether the gold annotations below were precomputed.
+    bool training_mode_;
+
+    // Gold label of each token.
+    vector<int> gold_labels_;
+
+    // Number of gold children without a head of each token, the root first.
+    vector<int> pending_children_;
 };
 
-class ArcStandardTransitionSystem : public ParserTransitionSystem {
+class ArcStandardTransitionSystem final
+        : public DevirtualizedTransitionSystem<ArcStandardTransitionSystem> {
 public:
     // Action types for the arc-standard transition system.
     enum ParserActionType {
@@ -130,16 +200,17 @@ public:
 
         // If the second token on the stack is the head of the first one, return a right
         // arc action.
+        const ArcStandardTransitionState &transition_state = TransitionState(state);
         if (state.GoldHead(state.Stack(0)) == state.Stack(1) &&
-            DoneChildrenRightOf(state, state.Stack(0))) {
-            const int gold_label = state.GoldLabel(state.Stack(0));
+            !transition_state.HasPendingChildren(state, state.Stack(0))) {
+            const int gold_label = transition_state.GoldLabel(state, state.Stack(0));
             return RightArcAction(gold_label);
         }
 
         // If the first token on the stack is the head of the second one, return a left arc
         // action.
         if (state.GoldHead(state.Stack(1)) == state.Top()) {
-            const int gold_label = state.GoldLabel(state.Stack(1));
+            const int gold_label = transition_state.GoldLabel(state, state.Stack(1));
             return LeftArcAction(gold_label);
         }
 
@@ -147,27 +218,178 @@ public:
         return ShiftAction();
     }
 
-    // Determines if a token has any children to the right in the sentence.
-    // Arc standard is a bottom-up parsing method and has to finish all sub-trees
-    // first.
-    static bool DoneChildrenRightOf(const ParserState &state, int head) {
-        int index = state.Next();
-        int num_tokens = state.sentence().token_size();
-        while (index < num_tokens) {
-            // Check if the token at index is the child of head.
-            int actual_head = state.GoldHead(index);
-            if (actual_head == head) return false;
+    // Returns the arc-standard state of a parser state.
+    static const ArcStandardTransitionState &TransitionState(const ParserState &state) {
+        return *static_cast<const ArcStandardTransitionState *>(state.transition_state());
+    }
 
-            // If the head of the token at index is to the right of it there cannot be
-            // any children in-between, so we can skip forward to the head. Note this
-            // is only true for projective trees.
-            if (actual_head > index) {
-                index = actual_head;
+    static ArcStandardTransitionState *MutableTransitionState(ParserState *state) {
+        return static_cast<ArcStandardTransitionState *>(state->mutable_transition_state());
+    }
+
+    /*!
+     * \brief Dynamic oracle. An action costs the correct heads and labels
+     * that the best tree reachable after it has less than the best tree
+     * reachable before, and the minimal cost is always 0.
+     *
+     * The best reachable tree is found exactly by Eisner's algorithm over the
+     * tokens that have no head yet, the stack from the root up followed by
+     * the input, scoring an arc 1 if it is gold. Arc-standard can build any
+     * projective tree over them but for two restrictions, as a stack token
+     * only becomes s_0 again once all tokens above it are its descendants:
+     * s_i can only take a head left of s_(i+1), the token below it, if
+     * s_(i+1) is its child, and s_i with i > 0 can only take a head on its
+     * left or a child from the stack if it also has a child on its right.
+     * O(n^3) per action type.
+     *
+     * An arc whose head is wrong is returned with every label, since none is
+     * better than the others.
+     */
+    void GetDynamicOracleActions(const ParserState &state,
+                                 vector<ParserAction> *actions) const override {
+        actions->clear();
+        const int stack_size = state.StackSize();
+        vector<int> stack(stack_size);
+        for (int i = 0; i < stack_size; ++i) stack[i] = state.Stack(stack_size - 1 - i);
+
+        // The cost of each action type, less that of the best one: the wrong
+        // arc it adds, if any, and the correct heads that cannot be reached
+        // after it, counting the arc as reached.
+        const int kNotAllowed = std::numeric_limits<int>::max();
+        int cost[3] = {kNotAllowed, kNotAllowed, kNotAllowed};
+        bool correct_head[3] = {false, false, false};
+        if (IsAllowedShift(state)) {
+            stack.push_back(state.Next());
+            cost[SHIFT] = -MaxReachableGoldArcs(state, stack, state.Next() + 1);
+            stack.pop_back();
+        }
+        if (IsAllowedRightArc(state)) {
+            const int s0 = stack.back();
+            correct_head[RIGHT_ARC] = state.GoldHead(s0) == stack[stack_size - 2];
+            stack.pop_back();
+            cost[RIGHT_ARC] = -correct_head[RIGHT_ARC] -
+                              MaxReachableGoldArcs(state, stack, state.Next());
+            stack.push_back(s0);
+        }
+        if (IsAllowedLeftArc(state)) {
+            const int s1 = stack[stack_size - 2];
+            correct_head[LEFT_ARC] = state.GoldHead(s1) == stack.back();
+            stack.erase(stack.end() - 2);
+            cost[LEFT_ARC] = -correct_head[LEFT_ARC] -
+                             MaxReachableGoldArcs(state, stack, state.Next());
+        }
+        const int min_cost = *std::min_element(cost, cost + 3);
+        if (cost[SHIFT] == min_cost) actions->push_back(ShiftAction());
+        for (ParserActionType type : {LEFT_ARC, RIGHT_ARC}) {
+            if (cost[type] != min_cost) continue;
+            const int dependent = state.Stack(type == LEFT_ARC ? 1 : 0);
+            if (correct_head[type]) {
+                const int label = TransitionState(state).GoldLabel(state, dependent);
+                actions->push_back(type == LEFT_ARC ? LeftArcAction(label)
+                                                    : RightArcAction(label));
             } else {
-                ++index;
+                for (int label = 0; label < state.NumLabels(); ++label) {
+                    actions->push_back(type == LEFT_ARC ? LeftArcAction(label)
+                                                        : RightArcAction(label));
+                }
             }
         }
-        return true;
+    }
+
+    // Returns the largest number of gold arcs over the tokens with no head
+    // of a tree reachable from the configuration with the given stack, from
+    // the root up, and next input token.
+    static int MaxReachableGoldArcs(const ParserState &state,
+                                    const vector<int> &stack, int next) {
+        // Active tokens, the stack and then the input, and the active
+        // position of the gold head of each.
+        const int stack_size = stack.size();
+        const int size = stack_size + state.NumTokens() - next;
+        vector<int> tokens(stack);
+        for (int i = next; i < state.NumTokens(); ++i) tokens.push_back(i);
+        vector<int> position(state.NumTokens() + 1, -1);
+        for (int p = 0; p < size; ++p) position[tokens[p] + 1] = p;
+        vector<int> gold_head(size, -1);
+        for (int p = 0; p < size; ++p) {
+            if (tokens[p] != -1) gold_head[p] = position[state.GoldHead(tokens[p]) + 1];
+        }
+
+        // Score of an arc: 1 if gold, kImpossible for the root as dependent.
+        const int kImpossible = -(1 << 24);
+        auto score = [&](int head, int dependent) {
+            if (tokens[dependent] == -1) return kImpossible;
+            return gold_head[dependent] == head ? 1 : 0;
+        };
+
+        // Stack positions whose head can be left of the token below only if
+        // that token is their child, and those that need a right child.
+        auto below_child = [stack_size](int p) { return p > 1 && p < stack_size; };
+        auto below_top = [stack_size](int p) { return p > 0 && p + 1 < stack_size; };
+
+        // Eisner's algorithm: the best complete and incomplete spans [s, t]
+        // headed at the left (index 1) or right (index 0) end, and the right
+        // incomplete spans in which s also has a child on its right. For the
+        // stack positions t > 1, the left complete and incomplete spans of t,
+        // indexed [t, s], in which t - 1 is a child of t, and the latter also
+        // with a right child of s.
+        auto at = [size](int s, int t) { return s * size + t; };
+        vector<int> complete[2], incomplete[2], incomplete_with_right(size * size, kImpossible);
+        vector<int> child_complete(stack_size * size, kImpossible);
+        vector<int> child_incomplete[2];
+        for (int d = 0; d < 2; ++d) {
+            complete[d].assign(size * size, 0);
+            incomplete[d].assign(size * size, kImpossible);
+            child_incomplete[d].assign(stack_size * size, kImpossible);
+        }
+        // The largest value(r) for r in [begin, end), at least kImpossible.
+        auto best_of = [kImpossible](int begin, int end, std::function<int(int)> value) {
+            int best = kImpossible;
+            for (int r = begin; r < end; ++r) best = std::max(best, value(r));
+            return best;
+        };
+        for (int length = 1; length < size; ++length) {
+            for (int s = 0; s + length < size; ++s) {
+                const int t = s + length;
+                auto split = [&](int r) {
+                    return complete[1][at(s, r)] + complete[0][at(r + 1, t)];
+                };
+                const int best = best_of(s, t, split);
+                incomplete[0][at(s, t)] = std::max(best + score(t, s), kImpossible);
+                incomplete_with_right[at(s, t)] =
+                    std::max(best_of(s + 1, t, split) + score(t, s), kImpossible);
+                int best_right = best;
+                if (below_child(t)) {
+                    auto child_split = [&](int r) {
+                        return complete[1][at(s, r)] + child_complete[at(t, r + 1)];
+                    };
+                    if (s + 1 == t) {
+                        child_incomplete[0][at(t, s)] = incomplete[0][at(s, t)];
+                        child_incomplete[1][at(t, s)] = incomplete_with_right[at(s, t)];
+                    } else {
+                        best_right = best_of(s, t - 1, child_split);
+                        child_incomplete[0][at(t, s)] =
+                            std::max(best_right + score(t, s), kImpossible);
+                        child_incomplete[1][at(t, s)] =
+                            std::max(best_of(s + 1, t - 1, child_split) + score(t, s),
+                                     kImpossible);
+                    }
+                    child_complete[at(t, s)] = best_of(s, t, [&](int r) {
+                        const bool with_right = below_top(r) && s < r;
+                        return complete[0][at(s, r)] + child_incomplete[with_right][at(t, r)];
+                    });
+                }
+                incomplete[1][at(s, t)] = std::max(best_right + score(s, t), kImpossible);
+                complete[0][at(s, t)] = best_of(s, t, [&](int r) {
+                    const bool with_right = below_top(r) && s < r;
+                    return complete[0][at(s, r)] + (with_right ? incomplete_with_right[at(r, t)]
+                                                                : incomplete[0][at(r, t)]);
+                });
+                complete[1][at(s, t)] = best_of(s + 1, below_top(t) ? t : t + 1, [&](int r) {
+                    return incomplete[1][at(s, r)] + complete[1][at(r, t)];
+                });
+            }
+        }
+        return complete[1][at(0, size - 1)];
     }
 
     // Checks if the action is allowed in a given parser state.
@@ -184,6 +406,20 @@ public:
         return false;
     }
 
+    // Checks each action type once, for the first label, and broadcasts the
+    // arcs across the labels.
+    void GetAllowedActions(const ParserState &state, int num_actions,
+                           uint8_t *mask) const override {
+        if (num_actions < NumActions(1)) {
+            ParserTransitionSystem::GetAllowedActions(state, num_actions, mask);
+            return;
+        }
+        mask[ShiftAction()] = IsAllowedShift(state);
+        mask[LeftArcAction(0)] = IsAllowedLeftArc(state);
+        mask[RightArcAction(0)] = IsAllowedRightArc(state);
+        BroadcastOverLabels(LeftArcAction(0), 2, num_actions, mask);
+    }
+
     bool IsAllowedShift(const ParserState &state) const {
         return !state.EndOfInput();
     }
@@ -228,7 +464,9 @@ public:
     void PerformLeftArc(ParserState *state, int label) const {
         DCHECK(IsAllowedLeftArc(*state));
         int s0 = state->Pop();
-        state->AddArc(state->Pop(), s0, label);
+        int s1 = state->Pop();
+        state->AddArc(s1, s0, label);
+        MutableTransitionState(state)->Attach(*state, s1);
         state->Push(s0);
     }
 
@@ -238,6 +476,7 @@ public:
         int s0 = state->Pop();
         int s1 = state->Pop();
         state->AddArc(s0, s1, label);
+        MutableTransitionState(state)->Attach(*state, s0);
         state->Push(s1);
     }
 
@@ -268,7 +507,8 @@ public:
 
     // Returns a new transition state to be used to enhance the parser state.
     ParserTransitionState *NewTransitionState(bool training_mode) const override {
-        return new ArcStandardTransitionState();
+        return new ArcStandardTransitionState(training_mode);
     }
 };
 
+REGISTER_TRANSITION_SYSTEM("arc-standard", ArcStandardTransitionSystem);
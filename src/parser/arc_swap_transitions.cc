@@ -0,0 +1,445 @@
+/*!
+ * \brief Arc-standard transition system with a swap transition, for
+ * non-projective trees (Nivre, Kuhlmann and Hall, 2009).
+ *
+ * This transition system has four types of actions:
+ *  SHIFT: It pushes the next input token to the stack and advances to the next input token.
+ *  SWAP: It moves the second token on the stack back to the front of the input.
+ *  LEFT_ARC: It adds a dependency relation from first to second token on the stack and removes second one.
+ *  RIGHT_ARC: It adds a dependency relation from second to first token on the stack and removes first one.
+ * SWAP is only allowed if the second token comes before the first one in the
+ * sentence, so tokens are reordered towards the projective order of the tree
+ * and every parse ends.
+ *
+ *  The transition system operates with parser actions encoded as intergers:
+ *  SHIFT: encoded as 0.
+ *  SWAP: encoded as 1.
+ *  LEFT_ARC: encoded as an even number starting from 2.
+ *  RIGHT_ARC: encoded as an odd number starting from 3.
+ */
+
+#include <string>
+#include <vector>
+
+#include "parser_state.h"
+#include "parser_transitions.h"
+
+using namespace std;
+
+class ArcSwapTransitionState : public ParserTransitionState {
+public:
+    explicit ArcSwapTransitionState(bool training_mode)
+            : training_mode_(training_mode) {}
+
+    ParserTransitionState *Clone() const override {
+        return new ArcSwapTransitionState(*this);
+    }
+
+    // Pushes the root on the stack before using the parser state in parsing.
+    // In training mode, also computes what the oracle needs of the gold tree:
+    // the labels, the number of children of each token, the projective order
+    // and the maximal projective components.
+    void Init(ParserState *state) override {
+        state->Push(-1);
+        if (!training_mode_) return;
+        const int num_tokens = state->NumTokens();
+        gold_labels_.resize(num_tokens);
+        pending_children_.assign(num_tokens + 1, 0);
+        vector<vector<int>> children(num_tokens + 1);
+        for (int i = 0; i < num_tokens; ++i) {
+            gold_labels_[i] = state->GoldLabel(i);
+            const int head = state->GoldHead(i);
+            ++pending_children_[head + 1];
+            children[head + 1].push_back(i);
+        }
+        ComputeProjectiveOrder(*state, children);
+        ComputeProjectiveComponents(*state);
+    }
+
+    // Records that a token was attached to a head, right or wrong.
+    void Attach(const ParserState &state, int index) {
+        if (training_mode_) --pending_children_[state.GoldHead(index) + 1];
+    }
+
+    // Returns the gold label of a token.
+    int GoldLabel(int index) const { return gold_labels_[index]; }
+
+    // Determines if a token has any gold children left without a head.
+    bool HasPendingChildren(int head) const { return pending_children_[head + 1] > 0; }
+
+    // Position of a token in the in-order traversal of the gold tree, where
+    // the tree is projective.
+    int ProjectiveOrder(int index) const { return projective_order_[index]; }
+
+    // The root of the maximal projective component of a token, the subtree
+    // of the gold tree that arc-standard builds without swapping.
+    int ProjectiveComponent(int index) const { return component_[index]; }
+
+    // Adds transition state specific annotations to the document.
+    void AddParseToDocument(const ParserState &state, bool rewrite_root_labels,
+                            Sentence *sentence) const override {
+        for (int i = 0; i < state.NumTokens(); ++i) {
+            Token *token = sentence->mutable_token(i);
+            token->set_label(state.LabelAsString(state.Label(i)));
+            if (state.Head(i) != -1) {
+                token->set_head(state.Head(i));
+            } else {
+                token->clear_head();
+                if (rewrite_root_labels) {
+                    token->set_label(state.LabelAsString(state.RootLabel()));
+                }
+            }
+        }
+    }
+
+    // Whether a parsed token should be considered correct for evaluation.
+    bool IsTokenCorrect(const ParserState &state, int index) const override {
+        return state.GoldHead(index) == state.Head(index);
+    }
+
+    // Returns a human readable string representation of this state.
+    string ToString(const ParserState &state) const override {
+        string str;
+        str.append("[");
+        for (int i = state.StackSize() - 1; i >= 0; --i) {
+            const StringPiece word = state.GetToken(state.Stack(i)).word();
+            if (i != state.StackSize() - 1) str.append(" ");
+            if (word.empty()) {
+                str.append(ParserState::kRootLabel);
+            } else {
+                str.append(word.data(), word.size());
+            }
+        }
+        str.append("]");
+        for (int offset = 0; state.Input(offset) >= 0; ++offset) {
+            str.append(state.GetToken(state.Input(offset)).word().ToString());
+            str.append(" ");
+        }
+        return str;
+    }
+
+private:
+    // Numbers the tokens by an in-order traversal of the gold tree: each head
+    // after its left children and before its right children. Tokens that
+    // the traversal does not reach, if the gold heads are no tree, follow in
+    // sentence order.
+    void ComputeProjectiveOrder(const ParserState &state,
+                                const vector<vector<int>> &children) {
+        const int num_tokens = state.NumTokens();
+        projective_order_.assign(num_tokens, -1);
+        int position = 0;
+
+        // Explicit stack of (head, next child) for the traversal.
+        vector<pair<int, int>> path = {{-1, 0}};
+        while (!path.empty()) {
+            const int head = path.back().first;
+            const int child = path.back().second++;
+            const vector<int> &head_children = children[head + 1];
+            if (child < static_cast<int>(head_children.size()) &&
+                head_children[child] < head) {
+                path.emplace_back(head_children[child], 0);
+                continue;
+            }
+            if (head != -1 && projective_order_[head] == -1) {
+                projective_order_[head] = position++;
+            }
+            if (child < static_cast<int>(head_children.size())) {
+                path.emplace_back(head_children[child], 0);
+            } else {
+                path.pop_back();
+            }
+        }
+        for (int i = 0; i < num_tokens; ++i) {
+            if (projective_order_[i] == -1) projective_order_[i] = position++;
+        }
+    }
+
+    // Runs the arc-standard static oracle over the sentence without swaps:
+    // the partial trees it builds are the maximal projective components.
+    void ComputeProjectiveComponents(const ParserState &state) {
+        const int num_tokens = state.NumTokens();
+        vector<int> pending(pending_children_);
+        vector<int> head(num_tokens, -1);
+        vector<int> stack;
+        for (int next = 0; next < num_tokens; ++next) {
+            stack.push_back(next);
+            while (stack.size() >= 2) {
+                const int s0 = stack.back();
+                const int s1 = stack[stack.size() - 2];
+                if (state.GoldHead(s1) == s0 && pending[s1 + 1] == 0) {
+                    head[s1] = s0;
+                    --pending[s0 + 1];
+                    stack.erase(stack.end() - 2);
+                } else if (state.GoldHead(s0) == s1 && pending[s0 + 1] == 0) {
+                    head[s0] = s1;
+                    --pending[s1 + 1];
+                    stack.pop_back();
+                } else {
+                    break;
+                }
+            }
+        }
+
+        // Each token belongs to the component of the root of its partial tree.
+        component_.assign(num_tokens, -1);
+        for (int i = 0; i < num_tokens; ++i) {
+            int root = i;
+            while (head[root] != -1) root = head[root];
+            component_[i] = root;
+        }
+    }
+
+    // Whether the gold annotations below were precomputed.
+    bool training_mode_;
+
+    // Gold label of each token.
+    vector<int> gold_labels_;
+
+    // Number of gold children without a head of each token, the root first.
+    vector<int> pending_children_;
+
+    // Projective order and maximal projective component of each token.
+    vector<int> projective_order_;
+    vector<int> component_;
+};
+
+class ArcSwapTransitionSystem final
+        : public DevirtualizedTransitionSystem<ArcSwapTransitionSystem> {
+public:
+    // Action types for the arc-standard swap transition system.
+    enum ParserActionType {
+        SHIFT = 0,
+        SWAP = 1,
+        LEFT_ARC = 2,
+        RIGHT_ARC = 3,
+    };
+
+    static ParserAction ShiftAction() { return SHIFT; }
+
+    static ParserAction SwapAction() { return SWAP; }
+
+    // The LEFT_ARC action converts the label to an even number greater or
+    // equal to 2.
+    static ParserAction LeftArcAction(int label) { return 2 + (label << 1); }
+
+    // The RIGHT_ARC action converts the label to an odd number greater or
+    // equal to 3.
+    static ParserAction RightArcAction(int label) { return 3 + (label << 1); }
+
+    static ParserActionType ActionType(ParserAction action) {
+        return static_cast<ParserActionType>(action < 2 ? action : 2 + (action & 1));
+    }
+
+    // Extracts the label from a given parser action. If the action is SHIFT
+    // or SWAP, returns -1.
+    static int Label(ParserAction action) {
+        return action < 2 ? -1 : (action - 2) >> 1;
+    }
+
+    // Returns the number of action types.
+    int NumActionTypes() const override { return 4; }
+
+    int NumActions(int num_labels) const override { return 2 + 2 * num_labels; }
+
+    // Returns the default action for a given state.
+    ParserAction GetDefaultAction(const ParserState &state) const override {
+        // If there are further tokens available in the input then Shift.
+        if (!state.EndOfInput()) {
+            return ShiftAction();
+        } else {
+            // Do a "reduce".
+            return RightArcAction(2);
+        }
+    }
+
+    /*!
+     * \brief Returns the next gold action for a given state, with the lazy
+     * swap strategy: an arc between the top two tokens of the stack if it is
+     * gold and its dependent has all its children, then SWAP if the two are
+     * out of projective order and the top token is not in the same maximal
+     * projective component as the next input token, and SHIFT otherwise.
+     * Postponing swaps until a component is complete keeps the number of
+     * transitions close to linear.
+     */
+    ParserAction GetNextGoldAction(const ParserState &state) const override {
+        // If the stack contains less than 2 tokens, the only valid parser action is
+        // shift.
+        if (state.StackSize() < 2) {
+            DCHECK(!state.EndOfInput());
+            return ShiftAction();
+        }
+
+        const ArcSwapTransitionState &transition_state = TransitionState(state);
+        const int s0 = state.Stack(0);
+        const int s1 = state.Stack(1);
+        if (s1 != -1 && state.GoldHead(s1) == s0 &&
+            !transition_state.HasPendingChildren(s1)) {
+            return LeftArcAction(transition_state.GoldLabel(s1));
+        }
+        if (state.GoldHead(s0) == s1 && !transition_state.HasPendingChildren(s0)) {
+            return RightArcAction(transition_state.GoldLabel(s0));
+        }
+        if (IsAllowedSwap(state) &&
+            transition_state.ProjectiveOrder(s0) < transition_state.ProjectiveOrder(s1) &&
+            (state.EndOfInput() || transition_state.ProjectiveComponent(s0) !=
+                                   transition_state.ProjectiveComponent(state.Next()))) {
+            return SwapAction();
+        }
+        return state.EndOfInput() ? RightArcAction(transition_state.GoldLabel(s0))
+                                  : ShiftAction();
+    }
+
+    // Returns the swap transition state of a parser state.
+    static const ArcSwapTransitionState &TransitionState(const ParserState &state) {
+        return *static_cast<const ArcSwapTransitionState *>(state.transition_state());
+    }
+
+    static ArcSwapTransitionState *MutableTransitionState(ParserState *state) {
+        return static_cast<ArcSwapTransitionState *>(state->mutable_transition_state());
+    }
+
+    // Checks if the action is allowed in a given parser state.
+    bool IsAllowedAction(ParserAction action,
+                         const ParserState &state) const override {
+        switch (ActionType(action)) {
+            case SHIFT:
+                return IsAllowedShift(state);
+            case SWAP:
+                return IsAllowedSwap(state);
+            case LEFT_ARC:
+                return IsAllowedLeftArc(state);
+            case RIGHT_ARC:
+                return IsAllowedRightArc(state);
+        }
+        return false;
+    }
+
+    // Checks each action type once, for the first label, and broadcasts the
+    // arcs across the labels.
+    void GetAllowedActions(const ParserState &state, int num_actions,
+                           uint8_t *mask) const override {
+        if (num_actions < NumActions(1)) {
+            ParserTransitionSystem::GetAllowedActions(state, num_actions, mask);
+            return;
+        }
+        mask[ShiftAction()] = IsAllowedShift(state);
+        mask[SwapAction()] = IsAllowedSwap(state);
+        mask[LeftArcAction(0)] = IsAllowedLeftArc(state);
+        mask[RightArcAction(0)] = IsAllowedRightArc(state);
+        BroadcastOverLabels(LeftArcAction(0), 2, num_actions, mask);
+    }
+
+    bool IsAllowedShift(const ParserState &state) const {
+        return !state.EndOfInput();
+    }
+
+    // Swap requires two tokens on the stack but the root, in sentence order,
+    // so no two tokens are swapped twice.
+    bool IsAllowedSwap(const ParserState &state) const {
+        return state.StackSize() > 2 && state.Stack(1) < state.Stack(0);
+    }
+
+    bool IsAllowedLeftArc(const ParserState &state) const {
+        // Left-arc requires two or more tokens on the stack but the first token
+        // is the root and we do not want a left arc to the root.
+        return state.StackSize() > 2;
+    }
+
+    bool IsAllowedRightArc(const ParserState &state) const {
+        return state.StackSize() > 1;
+    }
+
+    // Performs the specified action on a given parser state, without adding the
+    // action to the state's history.
+    void PerformActionWithoutHistory(ParserAction action,
+                                     ParserState *state) const override {
+        switch (ActionType(action)) {
+            case SHIFT:
+                PerformShift(state);
+                break;
+            case SWAP:
+                PerformSwap(state);
+                break;
+            case LEFT_ARC:
+                PerformLeftArc(state, Label(action));
+                break;
+            case RIGHT_ARC:
+                PerformRightArc(state, Label(action));
+                break;
+        }
+    }
+
+    // Makes a shift by pushing the next input token on the stack and moving to the
+    // next position.
+    void PerformShift(ParserState *state) const {
+        DCHECK(IsAllowedShift(*state));
+        state->Push(state->Next());
+        state->Advance();
+    }
+
+    // Moves the second token on the stack back to the input.
+    void PerformSwap(ParserState *state) const {
+        DCHECK(IsAllowedSwap(*state));
+        int s0 = state->Pop();
+        int s1 = state->Pop();
+        state->ReturnToInput(s1);
+        state->Push(s0);
+    }
+
+    // Makes a left-arc between the two top tokens on stack and pops the second token
+    // on stack.
+    void PerformLeftArc(ParserState *state, int label) const {
+        DCHECK(IsAllowedLeftArc(*state));
+        int s0 = state->Pop();
+        int s1 = state->Pop();
+        state->AddArc(s1, s0, label);
+        MutableTransitionState(state)->Attach(*state, s1);
+        state->Push(s0);
+    }
+
+    // Makes a right-arc between the two top tokens on stack and pops the stack.
+    void PerformRightArc(ParserState *state, int label) const {
+        DCHECK(IsAllowedRightArc(*state));
+        int s0 = state->Pop();
+        int s1 = state->Pop();
+        state->AddArc(s0, s1, label);
+        MutableTransitionState(state)->Attach(*state, s0);
+        state->Push(s1);
+    }
+
+    // We are in a deterministic state when we either reached the end of the input
+    // or reduced everything from the stack.
+    bool IsDeterministicState(const ParserState &state) const override {
+        return state.StackSize() < 2 && !state.EndOfInput();
+    }
+
+    // We are in a final state we reached the end of the input and the stack is
+    // empty.
+    bool IsFinalState(const ParserState &state) const override {
+        return state.EndOfInput() && state.StackSize() < 2;
+    }
+
+    string ActionAsString(ParserAction action,
+                          const ParserState &state) const override {
+        switch (ActionType(action)) {
+            case SHIFT:
+                return "SHIFT";
+            case SWAP:
+                return "SWAP";
+            case LEFT_ARC:
+                return "LEFT_ARC(" + state.LabelAsString(Label(action)) + ")";
+            case RIGHT_ARC:
+                return "RIGHT_ARC(" + state.LabelAsString(Label(action)) + ")";
+        }
+        return "UNKNOWN";
+    }
+
+    // Returns a new transition state to be used to enhance the parser state.
+    ParserTransitionState *NewTransitionState(bool training_mode) const override {
+        return new ArcSwapTransitionState(training_mode);
+    }
+
+    bool AllowsNonProjective() const override { return true; }
+};
+
+REGISTER_TRANSITION_SYSTEM("arc-standard-swap", ArcSwapTransitionSystem);
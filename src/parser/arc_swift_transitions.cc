@@ -0,0 +1,337 @@
+/*!
+ * \brief Arc-swift transition system (Qi and Manning, 2017).
+ *
+ * Arcs are made between the next input token j and any of the top K tokens
+ * of the stack i_1 ... i_K, with i_1 the top, rather than only between the
+ * top two tokens of the stack, so a sentence of n tokens is parsed in at
+ * most 2n and on average much fewer transitions than with arc-standard:
+ *  SHIFT: It pushes j to the stack and advances to the next input token.
+ *  LEFT_ARC(k): It adds a dependency relation from j to i_k and pops
+ *    i_1 ... i_k.
+ *  RIGHT_ARC(k): It adds a dependency relation from i_k to j, pops
+ *    i_1 ... i_(k-1), pushes j and advances to the next input token.
+ * Tokens can only be popped once they have a head, and the parse ends with
+ * the input, leaving any tokens on the stack without a head as roots.
+ *
+ * The transition system operates with parser actions encoded as integers,
+ * for labels l and arc lengths k from 1 to K:
+ *  SHIFT: encoded as 0.
+ *  LEFT_ARC(k): encoded as the odd number 1 + 2 * (l * K + k - 1).
+ *  RIGHT_ARC(k): encoded as the even number 2 + 2 * (l * K + k - 1).
+ *
+ * K is the "arc_swift_max_distance" parameter.
+ */
+
+#include <string>
+#include <vector>
+
+#include "parser_state.h"
+#include "parser_transitions.h"
+
+using namespace std;
+
+class ArcSwiftTransitionState : public ParserTransitionState {
+public:
+    ParserTransitionState *Clone() const override {
+        return new ArcSwiftTransitionState(*this);
+    }
+
+    // Pushes the root on the stack before using the parser state in parsing.
+    void Init(ParserState *state) override {
+        state->Push(-1);
+        attached_.assign(state->NumTokens(), false);
+    }
+
+    // Records that a token was given a head.
+    void Attach(int index) { attached_[index] = true; }
+
+    // Whether a token has a head; the root has none but can be popped.
+    bool IsAttached(int index) const { return index == -1 || attached_[index]; }
+
+    // Adds transition state specific annotations to the document.
+    void AddParseToDocument(const ParserState &state, bool rewrite_root_labels,
+                            Sentence *sentence) const override {
+        for (int i = 0; i < state.NumTokens(); ++i) {
+            Token *token = sentence->mutable_token(i);
+            token->set_label(state.LabelAsString(state.Label(i)));
+            if (state.Head(i) != -1) {
+                token->set_head(state.Head(i));
+            } else {
+                token->clear_head();
+                if (rewrite_root_labels) {
+                    token->set_label(state.LabelAsString(state.RootLabel()));
+                }
+            }
+        }
+    }
+
+    // Whether a parsed token should be considered correct for evaluation.
+    bool IsTokenCorrect(const ParserState &state, int index) const override {
+        return state.GoldHead(index) == state.Head(index);
+    }
+
+    // Returns a human readable string representation of this state.
+    string ToString(const ParserState &state) const override {
+        string str;
+        str.append("[");
+        for (int i = state.StackSize() - 1; i >= 0; --i) {
+            const StringPiece word = state.GetToken(state.Stack(i)).word();
+            if (i != state.StackSize() - 1) str.append(" ");
+            if (word.empty()) {
+                str.append(ParserState::kRootLabel);
+            } else {
+                str.append(word.data(), word.size());
+            }
+        }
+        str.append("]");
+        for (int i = state.Next(); i < state.NumTokens(); ++i) {
+            str.append(state.GetToken(i).word().ToString());
+            str.append(" ");
+        }
+        return str;
+    }
+
+private:
+    // Whether each token has been given a head, as ParserState::Head() does
+    // not tell the tokens attached to the root from those without a head.
+    vector<bool> attached_;
+};
+
+class ArcSwiftTransitionSystem final
+        : public DevirtualizedTransitionSystem<ArcSwiftTransitionSystem> {
+public:
+    // Action types for the arc-swift transition system.
+    enum ParserActionType {
+        SHIFT = 0,
+        LEFT_ARC = 1,
+        RIGHT_ARC = 2,
+    };
+
+    void Init(TaskContext *context) override {
+        max_distance_ = context->Get("arc_swift_max_distance", max_distance_);
+        CHECK_GT(max_distance_, 0);
+    }
+
+    static ParserAction ShiftAction() { return SHIFT; }
+
+    ParserAction LeftArcAction(int label, int distance) const {
+        return 1 + ((label * max_distance_ + distance - 1) << 1);
+    }
+
+    ParserAction RightArcAction(int label, int distance) const {
+        return 2 + ((label * max_distance_ + distance - 1) << 1);
+    }
+
+    static ParserActionType ActionType(ParserAction action) {
+        return static_cast<ParserActionType>(action < 1 ? action : 1 + (~action & 1));
+    }
+
+    // Extracts the label from a given parser action. If the action is SHIFT,
+    // returns -1.
+    int Label(ParserAction action) const {
+        return action < 1 ? -1 : ((action - 1) >> 1) / max_distance_;
+    }
+
+    // Extracts the stack position k of i_k, from 1, from an arc action.
+    int Distance(ParserAction action) const {
+        return ((action - 1) >> 1) % max_distance_ + 1;
+    }
+
+    // Returns the number of action types.
+    int NumActionTypes() const override { return 3; }
+
+    int NumActions(int num_labels) const override {
+        return 1 + 2 * max_distance_ * num_labels;
+    }
+
+    int max_distance() const { return max_distance_; }
+
+    // Returns the default action for a given state.
+    ParserAction GetDefaultAction(const ParserState &state) const override {
+        return ShiftAction();
+    }
+
+    /*!
+     * \brief Returns the next gold action for a given state: the arc between
+     * the next input token and the token i_k nearest to the top of the stack
+     * that is its gold head or dependent, if any, and otherwise SHIFT. For
+     * projective gold trees whose arcs span at most K stack tokens, this
+     * derives the gold tree.
+     */
+    ParserAction GetNextGoldAction(const ParserState &state) const override {
+        DCHECK(!state.EndOfInput());
+        const int next = state.Next();
+        const int next_head = state.GoldHead(next);
+        const int max_distance = std::min(max_distance_, state.StackSize());
+        for (int k = 1; k <= max_distance; ++k) {
+            const int token = state.Stack(k - 1);
+            if (token == next_head) {
+                const ParserAction action = RightArcAction(state.GoldLabel(next), k);
+                return IsAllowedRightArc(state, k) ? action : ShiftAction();
+            }
+            if (token != -1 && state.GoldHead(token) == next) {
+                const ParserAction action = LeftArcAction(state.GoldLabel(token), k);
+                return IsAllowedLeftArc(state, k) ? action : ShiftAction();
+            }
+        }
+        return ShiftAction();
+    }
+
+    // Returns the arc-swift state of a parser state.
+    static const ArcSwiftTransitionState &TransitionState(const ParserState &state) {
+        return *static_cast<const ArcSwiftTransitionState *>(state.transition_state());
+    }
+
+    static ArcSwiftTransitionState *MutableTransitionState(ParserState *state) {
+        return static_cast<ArcSwiftTransitionState *>(state->mutable_transition_state());
+    }
+
+    // Checks if the action is allowed in a given parser state.
+    bool IsAllowedAction(ParserAction action,
+                         const ParserState &state) const override {
+        switch (ActionType(action)) {
+            case SHIFT:
+                return IsAllowedShift(state);
+            case LEFT_ARC:
+                return IsAllowedLeftArc(state, Distance(action));
+            case RIGHT_ARC:
+                return IsAllowedRightArc(state, Distance(action));
+        }
+        return false;
+    }
+
+    // Checks the arcs of each distance once, for the first label, walking
+    // down the stack, and broadcasts them across the labels.
+    void GetAllowedActions(const ParserState &state, int num_actions,
+                           uint8_t *mask) const override {
+        if (num_actions < NumActions(1)) {
+            ParserTransitionSystem::GetAllowedActions(state, num_actions, mask);
+            return;
+        }
+        const ArcSwiftTransitionState &transition_state = TransitionState(state);
+        mask[ShiftAction()] = IsAllowedShift(state);
+
+        // Whether arcs can still reach down to i_k: the input is not done and
+        // i_1 ... i_(k-1) have heads.
+        bool reachable = !state.EndOfInput();
+        for (int k = 1; k <= max_distance_; ++k) {
+            const bool on_stack = reachable && k <= state.StackSize();
+            const bool attached = on_stack && transition_state.IsAttached(state.Stack(k - 1));
+            mask[LeftArcAction(0, k)] = on_stack && k < state.StackSize() && !attached;
+            mask[RightArcAction(0, k)] = on_stack;
+            reachable = attached;
+        }
+        BroadcastOverLabels(LeftArcAction(0, 1), 2 * max_distance_, num_actions, mask);
+    }
+
+    bool IsAllowedShift(const ParserState &state) const {
+        return !state.EndOfInput();
+    }
+
+    // Left-arc to i_k requires i_k to be a token without a head, not the
+    // root, and the tokens above it to have heads.
+    bool IsAllowedLeftArc(const ParserState &state, int distance) const {
+        if (state.EndOfInput() || distance >= state.StackSize()) return false;
+        const ArcSwiftTransitionState &transition_state = TransitionState(state);
+        if (transition_state.IsAttached(state.Stack(distance - 1))) return false;
+        return AreAttachedAbove(state, distance);
+    }
+
+    // Right-arc from i_k, which may be the root, requires the tokens above it
+    // to have heads.
+    bool IsAllowedRightArc(const ParserState &state, int distance) const {
+        if (state.EndOfInput() || distance > state.StackSize()) return false;
+        return AreAttachedAbove(state, distance);
+    }
+
+    // Whether i_1 ... i_(k-1) all have heads.
+    static bool AreAttachedAbove(const ParserState &state, int distance) {
+        const ArcSwiftTransitionState &transition_state = TransitionState(state);
+        for (int i = 0; i + 1 < distance; ++i) {
+            if (!transition_state.IsAttached(state.Stack(i))) return false;
+        }
+        return true;
+    }
+
+    // Performs the specified action on a given parser state, without adding the
+    // action to the state's history.
+    void PerformActionWithoutHistory(ParserAction action,
+                                     ParserState *state) const override {
+        switch (ActionType(action)) {
+            case SHIFT:
+                PerformShift(state);
+                break;
+            case LEFT_ARC:
+                PerformLeftArc(state, Label(action), Distance(action));
+                break;
+            case RIGHT_ARC:
+                PerformRightArc(state, Label(action), Distance(action));
+                break;
+        }
+    }
+
+    // Makes a shift by pushing the next input token on the stack and moving to the
+    // next position.
+    void PerformShift(ParserState *state) const {
+        DCHECK(IsAllowedShift(*state));
+        state->Push(state->Next());
+        state->Advance();
+    }
+
+    // Makes a left-arc from the next input token to i_k and pops i_1 ... i_k.
+    void PerformLeftArc(ParserState *state, int label, int distance) const {
+        DCHECK(IsAllowedLeftArc(*state, distance));
+        for (int i = 1; i < distance; ++i) state->Pop();
+        const int dependent = state->Pop();
+        state->AddArc(dependent, state->Next(), label);
+        MutableTransitionState(state)->Attach(dependent);
+    }
+
+    // Makes a right-arc from i_k to the next input token, pops i_1 ... i_(k-1)
+    // and shifts the next input token.
+    void PerformRightArc(ParserState *state, int label, int distance) const {
+        DCHECK(IsAllowedRightArc(*state, distance));
+        for (int i = 1; i < distance; ++i) state->Pop();
+        const int dependent = state->Next();
+        state->AddArc(dependent, state->Top(), label);
+        MutableTransitionState(state)->Attach(dependent);
+        state->Push(dependent);
+        state->Advance();
+    }
+
+    // Every state but the final ones allows both a shift and an arc.
+    bool IsDeterministicState(const ParserState &state) const override {
+        return false;
+    }
+
+    // We are in a final state once we reached the end of the input.
+    bool IsFinalState(const ParserState &state) const override {
+        return state.EndOfInput();
+    }
+
+    string ActionAsString(ParserAction action,
+                          const ParserState &state) const override {
+        switch (ActionType(action)) {
+            case SHIFT:
+                return "SHIFT";
+            case LEFT_ARC:
+                return "LEFT_ARC" + std::to_string(Distance(action)) + "(" +
+                       state.LabelAsString(Label(action)) + ")";
+            case RIGHT_ARC:
+                return "RIGHT_ARC" + std::to_string(Distance(action)) + "(" +
+                       state.LabelAsString(Label(action)) + ")";
+        }
+        return "UNKNOWN";
+    }
+
+    // Returns a new transition state to be used to enhance the parser state.
+    ParserTransitionState *NewTransitionState(bool training_mode) const override {
+        return new ArcSwiftTransitionState();
+    }
+
+private:
+    // Number of stack tokens K that arcs can reach.
+    int max_distance_ = 8;
+};
+
+REGISTER_TRANSITION_SYSTEM("arc-swift", ArcSwiftTransitionSystem);
@@ -0,0 +1,188 @@
+/*!
+ * \brief Exports the training examples of a corpus, the feature ids of every
+ * parser state on the gold derivation of each sentence and the gold action
+ * taken in it, as binary .npy files. The derivations are those of the
+ * registered transition system named by --transition_system.
+ *
+ * Usage (from the directory holding word-map, tag-map and label-map):
+ *
+ *   example_exporter [--resource_dir=.] [--spec=src/parser_features.fml]
+ *                    [--threads=0] [--transition_system=arc-standard]
+ *                    <corpus pattern>... <output prefix>
+ *
+ * The corpus is split into one shard per thread (all cores with 0), and the
+ * examples of shard i of n go to
+ *
+ *   <output prefix>-features-<i>-of-<n>.npy  int32 [examples, features]
+ *   <output prefix>-labels-<i>-of-<n>.npy    int32 [examples]
+ *
+ * A feature row holds the ids of each feature group of the spec in turn,
+ * as ParsingReader feeds them to the network, with -1 for features that do
+ * not fire. The files are mapped in place by mxnet/data_iter.py, replacing
+ * the text dump of the feature ids.
+ */
+#include <string.h>
+
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+#include "../feature/embedding_feature_extractor.h"
+#include "../io/npy_writer.h"
+#include "../io/text_reader.h"
+#include "../utils/shared_store.h"
+#include "parser_state.h"
+#include "parser_transitions.h"
+
+namespace {
+
+// Reads a whole file into a string.
+string ReadFile(const string &path) {
+    std::ifstream file(path);
+    CHECK(file) << "Cannot read " << path;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+// Adds an input with a single file to the task context.
+void AddInput(const string &name, const string &file, TaskContext *context) {
+    TaskInput *input = context->mutable_spec()->add_input();
+    input->set_name(name);
+    input->add_part()->set_file_pattern(file);
+}
+
+// Feature extraction and oracle of one thread.
+struct Exporter {
+    std::unique_ptr<ParserEmbeddingFeatureExtractor> features;
+    std::unique_ptr<ParserTransitionSystem> transition_system;
+    WorkspaceRegistry registry;
+    int64_t num_sentences = 0;
+    int64_t num_examples = 0;
+
+    // Writes the examples of the shard'th of num_shards shards of the
+    // corpus to the files of the shard.
+    void Export(const TaskInput &corpus, const TermFrequencyMap *label_map,
+                const string &prefix, int shard, int num_shards) {
+        int num_columns = 0;
+        for (int i = 0; i < features->NumEmbeddings(); ++i) {
+            num_columns += features->FeatureSize(i);
+        }
+        char suffix[64];
+        snprintf(suffix, sizeof(suffix), "-%05d-of-%05d.npy", shard, num_shards);
+        NpyWriter feature_rows(prefix + "-features" + suffix, num_columns);
+        NpyWriter labels(prefix + "-labels" + suffix, 0);
+
+        TextReader reader(corpus, 0, shard, num_shards);
+        WorkspaceSet workspace;
+        vector<FeatureVector> feature_vectors(features->NumEmbeddings());
+        vector<FeatureIds> feature_ids;
+        vector<int32_t> row(num_columns);
+        for (Sentence *sentence = reader.Read(); sentence != nullptr;
+             sentence = reader.Read()) {
+            ParserState state(sentence, transition_system->NewTransitionState(true),
+                              label_map);
+            workspace.Reset(registry);
+            features->Preprocess(&workspace, &state);
+            while (!transition_system->IsFinalState(state)) {
+                const ParserAction action = transition_system->GetNextGoldAction(state);
+                features->ExtractFeatureIds(workspace, state, &feature_vectors,
+                                            &feature_ids);
+                int32_t *column = row.data();
+                for (const FeatureIds &ids : feature_ids) {
+                    memcpy(column, ids.data(), ids.size() * sizeof(int32_t));
+                    column += ids.size();
+                }
+                feature_rows.Write(row.data());
+                labels.Write(action);
+                transition_system->PerformActionWithoutHistory(action, &state);
+            }
+            reader.Release(sentence);
+            ++num_sentences;
+        }
+        num_examples = labels.num_rows();
+    }
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    string resource_dir = ".";
+    string spec_file = "src/parser_features.fml";
+    int num_threads = 0;
+    string transition_system = "arc-standard";
+    vector<string> args;
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--resource_dir=", 15) == 0) {
+            resource_dir = argv[i] + 15;
+        } else if (strncmp(argv[i], "--spec=", 7) == 0) {
+            spec_file = argv[i] + 7;
+        } else if (strncmp(argv[i], "--threads=", 10) == 0) {
+            num_threads = atoi(argv[i] + 10);
+        } else if (strncmp(argv[i], "--transition_system=", 20) == 0) {
+            transition_system = argv[i] + 20;
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    if (args.size() < 2) {
+        fprintf(stderr, "Usage: %s [--resource_dir=.] [--spec=<fml file>] "
+                "[--threads=<n>] [--transition_system=<name>] "
+                "<corpus pattern>... <output prefix>\n", argv[0]);
+        return 1;
+    }
+    if (num_threads <= 0) num_threads = std::thread::hardware_concurrency();
+    if (num_threads <= 0) num_threads = 1;
+
+    // The feature spec as the parser uses it, without newlines.
+    string spec = ReadFile(spec_file);
+    for (char &c : spec) {
+        if (c == '\n') c = ' ';
+    }
+    TaskContext context;
+    AddInput("word-map", resource_dir + "/word-map", &context);
+    AddInput("tag-map", resource_dir + "/tag-map", &context);
+    AddInput("label-map", resource_dir + "/label-map", &context);
+    context.SetParameter("parser_features", spec);
+    context.SetParameter("parser_embedding_names", "words;tags;labels");
+    context.SetParameter("parser_embedding_dims", "64;32;32");
+    TaskInput corpus;
+    for (size_t i = 0; i + 1 < args.size(); ++i) {
+        corpus.add_part()->set_file_pattern(args[i]);
+    }
+    const string &prefix = args.back();
+
+    // Set up the extractors up front: the shared store is not thread-safe.
+    const string label_map_path = resource_dir + "/label-map";
+    const TermFrequencyMap *label_map =
+        SharedStoreUtils::GetWithDefaultName<TermFrequencyMap>(label_map_path, 0, 0);
+    vector<Exporter> exporters(num_threads);
+    for (Exporter &exporter : exporters) {
+        exporter.features.reset(new ParserEmbeddingFeatureExtractor("parser"));
+        exporter.features->Setup(&context);
+        exporter.transition_system.reset(ParserTransitionSystem::Create(transition_system));
+        exporter.transition_system->Setup(&context);
+        exporter.features->Init(&context);
+        exporter.transition_system->Init(&context);
+        exporter.features->RequestWorkspaces(&exporter.registry);
+    }
+
+    vector<std::thread> workers;
+    for (int w = 0; w < num_threads; ++w) {
+        workers.emplace_back([&, w]() {
+            exporters[w].Export(corpus, label_map, prefix, w, num_threads);
+        });
+    }
+    int64_t num_sentences = 0;
+    int64_t num_examples = 0;
+    for (int w = 0; w < num_threads; ++w) {
+        workers[w].join();
+        num_sentences += exporters[w].num_sentences;
+        num_examples += exporters[w].num_examples;
+    }
+    LOG(INFO) << "Exported " << num_examples << " examples of " << num_sentences
+              << " sentences to " << num_threads << " shards of " << prefix << ".";
+    SharedStore::Release(label_map);
+    return 0;
+}
@@ -36,24 +36,38 @@ ParserState *ParserState::Clone() const {
 
 int ParserState::RootLabel() const { return root_label_; }
 
+int ParserState::NumLabels() const { return label_map_->Size(); }
+
 int ParserState::Next() const {
     DCHECK_GE(next_, -1);
     DCHECK_LE(next_, num_tokens_);
-    return next_;
+    return returned_.empty() ? next_ : returned_.back();
 }
 
 int ParserState::Input(int offset) const {
-    int index = next_ + offset;
+    const int num_returned = returned_.size();
+    if (offset >= 0 && offset < num_returned) return returned_[num_returned - 1 - offset];
+    int index = next_ + offset - (offset >= 0 ? num_returned : 0);
     return index >= -1 && index < num_tokens_ ? index : -2;
 }
 
 void ParserState::Advance() {
+    if (!returned_.empty()) {
+        returned_.pop_back();
+        return;
+    }
     DCHECK_LT(next_, num_tokens_);
     ++next_;
 }
 
+void ParserState::ReturnToInput(int index) {
+    DCHECK_GE(index, 0);
+    DCHECK_LT(index, num_tokens_);
+    returned_.push_back(index);
+}
+
 bool ParserState::EndOfInput() const {
-    return next_ == num_tokens_;
+    return next_ == num_tokens_ && returned_.empty();
 }
 
 void ParserState::Push(int index) {
@@ -182,9 +196,9 @@ int ParserState::GoldLabel(int index) const {
     DCHECK_GE(index, -1);
     DCHECK_LT(index, num_tokens_);
     if (index == -1) return RootLabel();
-    string gold_label;
-    gold_label = GetToken(index).label();
-    return label_map_->LookupIndex(gold_label, RootLabel() /* unknown */);
+    const Token &token = GetToken(index);
+    return label_map_->LookupIndex(token.label(), token.label_id(),
+                                   RootLabel() /* unknown */);
 }
 
 void ParserState::AddParseToDocument(Sentence *document, bool rewrite_root_labels) const {
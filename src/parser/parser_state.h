@@ -32,6 +32,9 @@ public:
     // Returns the root label.
     int RootLabel() const;
 
+    // Returns the number of dependency labels.
+    int NumLabels() const;
+
     // Returns the index of the next input token.
     int Next() const;
 
@@ -45,6 +48,10 @@ public:
     // Advances to the next input token.
     void Advance();
 
+    // Puts a token that was read back in front of the input, as the swap
+    // transition of non-projective transition systems does.
+    void ReturnToInput(int index);
+
     // Returns true if all tokens have been processed.
     bool EndOfInput() const;
 
@@ -158,9 +165,13 @@ private:
     // Root label.
     int root_label_;
 
-    // Index of the next input token.
+    // Index of the next input token not read yet.
     int next_;
 
+    // Tokens returned to the input, which come before next_, the first one
+    // last.
+    std::vector<int> returned_;
+
     // Parse stack of partially processed tokens.
     std::vector<int> stack_;
 
@@ -2,7 +2,25 @@
 
 #include "parser_state.h"
 
+REGISTER_CLASS_REGISTRY("transition system", ParserTransitionSystem);
+
 void ParserTransitionSystem::PerformAction(ParserAction action,
                                            ParserState *state) const {
     PerformActionWithoutHistory(action, state);
 }
+
+ParserAction ParserTransitionSystem::BestAllowedAction(const ParserState &state,
+                                                       const float *scores,
+                                                       int num_actions,
+                                                       vector<uint8_t> *mask) const {
+    return SelectBestAllowedAction(*this, state, scores, num_actions, mask);
+}
+
+ParserAction ParserTransitionSystem::PerformBestAllowedAction(const float *scores,
+                                                              int num_actions,
+                                                              vector<uint8_t> *mask,
+                                                              ParserState *state) const {
+    const ParserAction action = BestAllowedAction(*state, scores, num_actions, mask);
+    PerformActionWithoutHistory(action, state);
+    return action;
+}
@@ -1,6 +1,12 @@
 #ifndef PARSER_TRANSITIONS_H_
 #define PARSER_TRANSITIONS_H_
 
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "../utils/registry.h"
 #include "../utils/utils.h"
 #include "../utils/task_context.h"
 
@@ -49,9 +55,12 @@ public:
  * traning the transition system is used for extracting a canonical sequence of 
  * transitions for an annotated sentence. During parsing the transition system is
  * used for applying the predicated transitions to the parser state and therefore build
- * the parse tree for the sentence
+ * the parse tree for the sentence.
+ *
+ * Transition systems are registered by name with REGISTER_TRANSITION_SYSTEM, and
+ * readers create the one named by their "<prefix>_transition_system" parameter.
  */
-class ParserTransitionSystem {
+class ParserTransitionSystem : public RegisterableClass<ParserTransitionSystem> {
 public:
     ParserTransitionSystem() {}
 
@@ -92,6 +101,14 @@ public:
         *actions = {action};
     }
 
+    // Returns the actions of minimal cost from any state, also one off the
+    // gold path (a dynamic oracle): those after which the best reachable tree
+    // has as many correct heads and labels as the best tree reachable before.
+    virtual void GetDynamicOracleActions(const ParserState &state,
+                                         vector<ParserAction> *actions) const {
+        LOG(FATAL) << "The transition system has no dynamic oracle.";
+    }
+
     // Internally counts all next gold actions from the current parser state.
     virtual void CountAllNextGoldActions(const ParserState &state) {}
 
@@ -102,6 +119,27 @@ public:
     virtual bool IsAllowedAction(ParserAction action,
                                  const ParserState &state) const = 0;
 
+    // Sets mask[action] to whether each of the first num_actions actions is
+    // allowed in the given state. Transition systems override this to check
+    // each action type once and broadcast the result across the labels.
+    virtual void GetAllowedActions(const ParserState &state, int num_actions,
+                                   uint8_t *mask) const {
+        for (int action = 0; action < num_actions; ++action) {
+            mask[action] = IsAllowedAction(action, state);
+        }
+    }
+
+    // Returns the allowed action with the highest of the scores of the first
+    // num_actions actions, or 0 if none is allowed. mask is scratch space.
+    virtual ParserAction BestAllowedAction(const ParserState &state, const float *scores,
+                                           int num_actions, vector<uint8_t> *mask) const;
+
+    // Performs the allowed action with the highest score on the state, one
+    // step of greedy decoding, and returns it.
+    virtual ParserAction PerformBestAllowedAction(const float *scores, int num_actions,
+                                                  vector<uint8_t> *mask,
+                                                  ParserState *state) const;
+
     // Performs the specified action on a given parser state. The action is
     // saved in the state's history.
     void PerformAction(ParserAction action, ParserState *state) const;
@@ -146,6 +184,71 @@ public:
                             const ParserAction &action) const {
         return -1;
     }
+
+protected:
+    // Copies the legality of the actions of the first label, the block of
+    // block_size actions from first, to the blocks of the other labels.
+    static void BroadcastOverLabels(int first, int block_size, int num_actions,
+                                    uint8_t *mask) {
+        for (int block = first + block_size; block < num_actions; block += block_size) {
+            memcpy(mask + block, mask + first, std::min(block_size, num_actions - block));
+        }
+    }
+};
+
+/*!
+ * \brief Returns the allowed action with the highest score. Instantiated with a
+ * concrete (final) transition system, the legality checks are resolved at
+ * compile time and inlined.
+ */
+template <class TransitionSystem>
+ParserAction SelectBestAllowedAction(const TransitionSystem &system,
+                                     const ParserState &state, const float *scores,
+                                     int num_actions, vector<uint8_t> *mask) {
+    mask->resize(num_actions);
+    system.GetAllowedActions(state, num_actions, mask->data());
+    ParserAction best_action = 0;
+    float best_score = -std::numeric_limits<float>::max();
+    for (int action = 0; action < num_actions; ++action) {
+        if ((*mask)[action] && scores[action] > best_score) {
+            best_action = action;
+            best_score = scores[action];
+        }
+    }
+    return best_action;
+}
+
+/*!
+ * \brief Base of the concrete transition systems, which implements the
+ * decoding steps of ParserTransitionSystem on the derived class, so that a
+ * step costs one virtual call rather than one per action. Derived classes
+ * must be final, e.g.
+ *
+ *   class ArcStandardTransitionSystem final
+ *       : public DevirtualizedTransitionSystem<ArcStandardTransitionSystem> {...};
+ */
+template <class Derived>
+class DevirtualizedTransitionSystem : public ParserTransitionSystem {
+public:
+    ParserAction BestAllowedAction(const ParserState &state, const float *scores,
+                                   int num_actions, vector<uint8_t> *mask) const override {
+        return SelectBestAllowedAction(derived(), state, scores, num_actions, mask);
+    }
+
+    ParserAction PerformBestAllowedAction(const float *scores, int num_actions,
+                                          vector<uint8_t> *mask,
+                                          ParserState *state) const override {
+        const ParserAction action =
+            SelectBestAllowedAction(derived(), *state, scores, num_actions, mask);
+        derived().PerformActionWithoutHistory(action, state);
+        return action;
+    }
+
+private:
+    const Derived &derived() const { return static_cast<const Derived &>(*this); }
 };
 
+#define REGISTER_TRANSITION_SYSTEM(type, component) \
+  REGISTER_CLASS_COMPONENT(ParserTransitionSystem, type, component)
+
 #endif
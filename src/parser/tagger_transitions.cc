@@ -37,7 +37,8 @@ class TaggerTransitionState : public ParserTransitionState {
       tag_.resize(state->sentence().token_size(), -1);
       gold_tag_.resize(state->sentence().token_size(), -1);
       for (int pos = 0; pos < state->sentence().token_size(); ++pos) {
-        int tag = tag_map_->LookupIndex(state->GetToken(pos).tag(), -1);
+        const Token &token = state->GetToken(pos);
+        int tag = tag_map_->LookupIndex(token.tag(), token.tag_id(), -1);
         gold_tag_[pos] = tag;
       }
     }
@@ -86,12 +87,12 @@ class TaggerTransitionState : public ParserTransitionState {
     std::string ToString(const ParserState &state) const override {
       string str;
       for (int i = state.StackSize(); i > 0; --i) {
-        const string &word = state.GetToken(state.Stack(i - 1)).word();
+        const StringPiece word = state.GetToken(state.Stack(i - 1)).word();
         if (i != state.StackSize() - 1) str.append(" ");
-        str.append(word).append("[").append(TagAsString(Tag(state.StackSize() - i))).append("]");
+        str.append(word.data(), word.size()).append("[").append(TagAsString(Tag(state.StackSize() - i))).append("]");
       }
       for (int i = state.Next(); i < state.NumTokens(); ++i) {
-        str.append(" ").append(state.GetToken(i).word());
+        str.append(" ").append(state.GetToken(i).word().ToString());
       }
       return str;
     }
@@ -112,7 +113,8 @@ class TaggerTransitionState : public ParserTransitionState {
 };
 
 
-class TaggerTransitionSystem : public ParserTransitionSystem {
+class TaggerTransitionSystem final
+    : public DevirtualizedTransitionSystem<TaggerTransitionSystem> {
   public:
     ~TaggerTransitionSystem() override {}
 
@@ -156,6 +158,12 @@ class TaggerTransitionSystem : public ParserTransitionSystem {
       return !state.EndOfInput();
     }
 
+  // Every tag is allowed until the end of the input.
+  void GetAllowedActions(const ParserState &state, int num_actions,
+                         uint8_t *mask) const override {
+    memset(mask, !state.EndOfInput(), num_actions);
+  }
+
   // Makes a shift by pushing the next input token on the stack and moving
   // to the next position.
   void PerformActionWithoutHistory(ParserAction action,
@@ -208,3 +216,4 @@ class TaggerTransitionSystem : public ParserTransitionSystem {
     const TagToCategoryMap *tag_to_category_ = nullptr;
 };
 
+REGISTER_TRANSITION_SYSTEM("tagger", TaggerTransitionSystem);
@@ -1,6 +1,10 @@
-#include <deque>
+#include <algorithm>
+#include <random>
+
 #include "utils/utils.h"
 #include "sentence_batch.h"
+#include "io/conll_writer.h"
+#include "io/oracle_trace_cache.h"
 #include "parser/parser_state.h"
 #include "utils/task_context.h"
 #include "utils/work_space.h"
@@ -27,11 +31,13 @@ public:
         workspaces_.resize(max_batch_size_);
         features_.reset(new ParserEmbeddingFeatureExtractor(arg_prefix_));
         features_->Setup(context);
-        transition_system_.reset(new ArcStandardTransitionSystem());
+        transition_system_.reset(ParserTransitionSystem::Create(
+                context->Get(arg_prefix_ + "_transition_system", "arc-standard")));
         transition_system_->Setup(context);
 
         features_->Init(context);
         features_->RequestWorkspaces(&workspace_registry_);
+        feature_vectors_.resize(features_->NumEmbeddings());
 
         transition_system_->Init(context);
 
@@ -79,8 +85,7 @@ public:
 
         // Rewinds if no states remain in the batch (we need to re-wind the corpus).
         if (sentence_batch_->size() == 0) {
-            ++num_epochs_;
-            LOG(INFO) << "Starting epoch " << num_epochs_;
+            StartEpoch();
             sentence_batch_->Rewind();
             for (int i = 0; i < max_batch_size_; ++i) {
                 AdvanceSentence(i);
@@ -97,13 +102,13 @@ public:
 
             // Extract features from the current parser state, and fill up the
             // available batch slots.
-            vector<vector<SparseFeatures>> features =
-                    features_->ExtractSparseFeatures(workspaces_[i], *states_[i]);
+            features_->ExtractFeatureIds(workspaces_[i], *states_[i],
+                                         &feature_vectors_, &feature_ids_);
 
-            for (size_t j = 0; j < features.size(); ++j) {
-                for (size_t k = 0; k < features[j].size(); ++k) {
-                    feature_outputs_[j].push_back(features[j][k].id_[0]);
-                }
+            for (size_t j = 0; j < feature_ids_.size(); ++j) {
+                const FeatureIds &ids = feature_ids_[j];
+                feature_outputs_[j].insert(feature_outputs_[j].end(),
+                                           ids.data(), ids.data() + ids.size());
             }
             ++index;
         }
@@ -119,7 +124,13 @@ protected:
     // action or a predicated action from decoding.
     virtual void PerformActions() = 0;
 
-    virtual void AddAdditionalOutputs() const = 0;
+    virtual void AddAdditionalOutputs() = 0;
+
+    // Counts a new pass over the corpus.
+    void StartEpoch() {
+        ++num_epochs_;
+        LOG(INFO) << "Starting epoch " << num_epochs_;
+    }
 
     // Accessors.
     int max_batch_size() const { return max_batch_size_; }
@@ -132,6 +143,8 @@ protected:
         return *transition_system_.get();
     }
 
+    const ParserEmbeddingFeatureExtractor &features() const { return *features_; }
+
 public:
     const int num_epochs() const { return num_epochs_; }
 
@@ -165,42 +178,164 @@ private:
 
     WorkspaceRegistry workspace_registry_;
 
+    // Scratch buffers for feature extraction, reused across states.
+    vector<FeatureVector> feature_vectors_;
+    vector<FeatureIds> feature_ids_;
+
 public:
     vector<vector<float> > feature_outputs_;
 };
 
+/*!
+ * \brief GoldParseReader follows the gold derivation of each sentence, and outputs the
+ * gold action of each state of the batch along with its features.
+ *
+ * The gold derivations do not change between epochs. With the "oracle_trace_cache"
+ * parameter set to a file, the first epoch also records the feature ids and gold actions
+ * of each sentence there, and later epochs replay them in a new random order each epoch,
+ * without reading, parsing or extracting features again.
+ */
 class GoldParseReader : public ParsingReader {
 public:
     explicit GoldParseReader(TaskContext *context)
-            : ParsingReader(context) {}
+            : ParsingReader(context),
+              random_(context->Get("oracle_trace_seed", 0)) {
+        const string cache_path = context->Get("oracle_trace_cache", "");
+        if (!cache_path.empty()) {
+            int num_columns = 0;
+            for (int i = 0; i < features().NumEmbeddings(); ++i) {
+                num_columns += features().FeatureSize(i);
+            }
+            cache_.reset(new OracleTraceCache(cache_path, num_columns));
+            traces_.resize(max_batch_size());
+            trace_rows_.assign(max_batch_size(), 0);
+        }
+    }
+
+    void Compute() override {
+        if (cache_ != nullptr && cache_->finished()) {
+            ReplayTraces();
+            return;
+        }
+        ParsingReader::Compute();
+
+        // The first epoch is over: replay it from the cache.
+        if (cache_ != nullptr && num_epochs() > 1) {
+            cache_->Finish();
+            for (vector<int32_t> &trace : traces_) trace.clear();
+            ShuffleTraces();
+            ReplayTraces();
+        }
+    }
 
 private:
+    // Records the trace of a finished sentence before moving on.
+    void AdvanceSentence(int index) override {
+        if (cache_ != nullptr && !traces_[index].empty()) {
+            cache_->Write(traces_[index]);
+            traces_[index].clear();
+        }
+        ParsingReader::AdvanceSentence(index);
+    }
+
     // Always performs the next gold action for each state.
     void PerformActions() override {
-        for (int i = 0; i < max_batch_size(); ++i) {
+        for (int i = 0, batch_index = 0; i < max_batch_size(); ++i) {
             if (state(i) != nullptr) {
-                transition_system().PerformAction(
-                        transition_system().GetNextGoldAction(*state(i)), state(i));
+                transition_system().PerformAction(gold_actions_[batch_index++], state(i));
             }
         }
     }
 
-    // Adds the list of gold actions for each state as an additional output.
-    void AddAdditionalOutputs() const override {
+    // Adds the list of gold actions for each state as an additional output, and
+    // appends the states to the traces of their sentences on the first epoch.
+    void AddAdditionalOutputs() override {
+        gold_actions_.clear();
+        const bool record = cache_ != nullptr && num_epochs() == 1;
+        for (int i = 0; i < max_batch_size(); ++i) {
+            if (state(i) == nullptr) continue;
+            const int batch_index = gold_actions_.size();
+            gold_actions_.push_back(transition_system().GetNextGoldAction(*state(i)));
+            if (!record) continue;
+            for (int j = 0; j < features().NumEmbeddings(); ++j) {
+                const int size = features().FeatureSize(j);
+                const float *ids = feature_outputs_[j].data() + batch_index * size;
+                traces_[i].insert(traces_[i].end(), ids, ids + size);
+            }
+            traces_[i].push_back(gold_actions_.back());
+        }
+    }
+
+    // Draws the order in which the traces of the next epoch are replayed.
+    void ShuffleTraces() {
+        trace_order_.resize(cache_->num_traces());
+        for (int i = 0; i < cache_->num_traces(); ++i) trace_order_[i] = i;
+        std::shuffle(trace_order_.begin(), trace_order_.end(), random_);
+        next_trace_ = 0;
     }
+
+    // Outputs the next state of the trace in each slot of the batch, as the
+    // parsing would. Slots take the next trace of the epoch when theirs ends.
+    void ReplayTraces() {
+        const int row_size = cache_->row_size();
+        bool any = false;
+        for (int pass = 0; pass < 2 && !any; ++pass) {
+            // Starts a new epoch when all traces are replayed.
+            if (pass == 1) {
+                StartEpoch();
+                ShuffleTraces();
+            }
+            for (int i = 0; i < max_batch_size(); ++i) {
+                while (trace_rows_[i] * row_size == traces_[i].size() &&
+                       next_trace_ < trace_order_.size()) {
+                    cache_->Read(trace_order_[next_trace_++], &traces_[i]);
+                    trace_rows_[i] = 0;
+                }
+                any |= trace_rows_[i] * row_size < traces_[i].size();
+            }
+        }
+        CHECK(any) << "The corpus has no parser states.";
+
+        feature_outputs_.clear();
+        feature_outputs_.resize(features().NumEmbeddings());
+        gold_actions_.clear();
+        for (int i = 0; i < max_batch_size(); ++i) {
+            if (trace_rows_[i] * row_size == traces_[i].size()) continue;
+            const int32_t *row = traces_[i].data() + trace_rows_[i]++ * row_size;
+            for (int j = 0; j < features().NumEmbeddings(); ++j) {
+                const int size = features().FeatureSize(j);
+                feature_outputs_[j].insert(feature_outputs_[j].end(), row, row + size);
+                row += size;
+            }
+            gold_actions_.push_back(*row);
+        }
+    }
+
+public:
+    // Gold action of each state of the batch, in batch order.
+    vector<int> gold_actions_;
+
+private:
+    // Cache of the traces, and in each slot of the batch the trace being
+    // recorded or replayed, with the number of its rows replayed.
+    std::unique_ptr<OracleTraceCache> cache_;
+    vector<vector<int32_t>> traces_;
+    vector<size_t> trace_rows_;
+
+    // Order of the traces in the epoch being replayed and the next one.
+    vector<int> trace_order_;
+    size_t next_trace_ = 0;
+
+    std::mt19937 random_;
 };
 
 /*!
- * \brief DecodedParseReader parses sentences using transition scores computed by neural
- * network. This op additionally computes a token correctness evaluation metric which can
- * be used to select hyperparameter settings and training stopping point.
- *
- * The notion of correct token is determined by the transition system. e.g. a tagger will
- * return POS tag accuracy, while an arc-standard parser will return UAS.
+ * \brief ModelParseReader scores the actions of the states of the batch with the greedy
+ * network, for the readers that follow the model's predictions.
  */
-class DecodedParseReader : public ParsingReader {
+class ModelParseReader : public ParsingReader {
 public:
-    explicit DecodedParseReader(TaskContext *context)
+    explicit ModelParseReader(TaskContext *context)
             : ParsingReader(context) {
         // Put symbol, param into context.
         string symbol = "mxnet/greedy-symbol.json";
@@ -210,16 +345,8 @@ public:
         greedy_model_->Init(context);
     }
 
-private:
-  void AdvanceSentence(int index) override {
-    ParsingReader::AdvanceSentence(index);
-    if (state(index)) {
-      docids_.push_front(state(index)->sentence().docid());
-    }
-  }
-    
-public:
-    void ComputeMatrix() {
+    // Scores the actions of the states whose features Compute() extracted.
+    virtual void ComputeMatrix() {
         vector<string> feature_names = {"feature_0_data", "feature_1_data", "feature_2_data"};
         vector<int> feature_sizes = {20, 20, 12};
         // padding.
@@ -236,6 +363,57 @@ public:
         greedy_model_->DoPredict(feature_outputs_, feature_names, feature_sizes, &scores_matrix_);
     }
 
+protected:
+    // Returns the scores of the actions for the state at the given index of
+    // the scored batch.
+    const float *Scores(int batch_index) {
+        return scores_matrix_.mutable_data() + batch_index * scores_matrix_.col();
+    }
+
+    // Returns the allowed action with the highest score for the state at the
+    // given index of the scored batch.
+    int BestAllowedAction(int batch_index, const ParserState &state) {
+        return transition_system().BestAllowedAction(state, Scores(batch_index),
+                                                      scores_matrix_.col(), &allowed_);
+    }
+
+    // Scratch buffer for the allowed actions of a state.
+    vector<uint8_t> allowed_;
+
+public:
+    typedef Matrix ScoreMatrix;
+
+    ScoreMatrix scores_matrix_;
+    Model *greedy_model_;
+};
+
+/*!
+ * \brief DecodedParseReader parses sentences using transition scores computed by neural
+ * network. This op additionally computes a token correctness evaluation metric which can
+ * be used to select hyperparameter settings and training stopping point.
+ *
+ * The notion of correct token is determined by the transition system. e.g. a tagger will
+ * return POS tag accuracy, while an arc-standard parser will return UAS.
+ */
+class DecodedParseReader : public ModelParseReader {
+public:
+    explicit DecodedParseReader(TaskContext *context)
+            : ModelParseReader(context) {
+        // The parses go to the "output_file" parameter, by default stdout.
+        writer_.reset(new CoNLLWriter(context->Get("output_file", "stdout"),
+                                      2 * max_batch_size()));
+        sentence_indices_.resize(max_batch_size());
+    }
+
+private:
+  // Numbers the sentences in the order they are read, which is the order
+  // they are written in.
+  void AdvanceSentence(int index) override {
+    ParsingReader::AdvanceSentence(index);
+    if (state(index)) sentence_indices_[index] = num_sentences_read_++;
+  }
+    
+public:
     void ComputeTokenAccuracy(const ParserState &state) {
     }
 
@@ -247,43 +425,27 @@ public:
         for (int i = 0, batch_index = 0; i < max_batch_size(); ++i) {
             ParserState *state = this->state(i);
             if (state != nullptr) {
-                int best_action = 0;
-                float best_score = -std::numeric_limits<float>::max();
-                for (int action = 0; action < scores_matrix_.col_; ++action) {
-                    float score = scores_matrix_(batch_index, action);
-                    if (score > best_score &&
-                        transition_system().IsAllowedAction(action, *state)) {
-                        best_action = action;
-                        best_score = score;
-                    }
-                }
-                // LOG(INFO) << "Parser action: " << transition_system().ActionAsString(best_action, *state);
-                transition_system().PerformAction(best_action, state);
+                // One virtual call, in which the transition system checks
+                // and performs the actions inline.
+                transition_system().PerformBestAllowedAction(
+                        Scores(batch_index), scores_matrix_.col(), &allowed_, state);
 
                 // Update the # of scored correct tokens if this is the last state
-                // in the sentence and save the annotated document.
+                // in the sentence and write the annotated document.
                 if (transition_system().IsFinalState(*state)) {
-                    sentence_map_[state->sentence().docid()] = state->mutable_sentence();
-                    state->AddParseToDocument(sentence_map_[state->sentence().docid()]);
-                    CoNLLSyntaxFormat conll;
-                    string key;
-                    string value;
-                    conll.ConvertToString(*state->mutable_sentence(), &key, &value);
-                    conll_result_[key] =value;
+                    state->AddParseToDocument(state->mutable_sentence());
+                    writer_->Write(sentence_indices_[i], state->sentence());
                 }
                 ++batch_index;
             }
         }
     }
 
-    void AddAdditionalOutputs() const override {
+    void AddAdditionalOutputs() override {
     }
 
-    void OutputCoNLLResult() {
-      for (size_t i = 0; i < conll_result_.size(); ++i) {
-        cout << conll_result_[utils::Printf(i)];
-      }
-    }
+    // Writes the rest of the parsed sentences and closes the output.
+    void OutputCoNLLResult() { writer_->Close(); }
 
 public:
     int num_tokens_ = 0;
@@ -291,14 +453,79 @@ public:
 
     string scoring_type_;
 
-    std::deque<string> docids_;
-    map<string, Sentence*> sentence_map_;
-    typedef Matrix ScoreMatrix;
+    // Writer of the parsed sentences, and the index of the sentence of each
+    // state in the order they were read.
+    std::unique_ptr<CoNLLWriter> writer_;
+    vector<int64_t> sentence_indices_;
+    int64_t num_sentences_read_ = 0;
+};
 
-    ScoreMatrix scores_matrix_;
-    Model *greedy_model_;
+/*!
+ * \brief ExplorationParseReader trains on the states the model reaches rather than on
+ * the gold derivation only. Each state is labeled with the best scoring action among
+ * those the dynamic oracle of the transition system finds optimal from it, and takes
+ * the model's best allowed action with probability "exploration_probability" and the
+ * label otherwise, so the derivations leave the gold one as the model makes mistakes.
+ *
+ * After Compute() and ComputeMatrix(), feature_outputs_ holds the features of the
+ * states of the batch and oracle_actions_ their labels.
+ */
+class ExplorationParseReader : public ModelParseReader {
+public:
+    explicit ExplorationParseReader(TaskContext *context)
+            : ModelParseReader(context),
+              exploration_probability_(context->Get("exploration_probability", 0.9)),
+              random_(context->Get("exploration_seed", 0)) {}
+
+    // Scores the batch and labels each state with its best optimal action.
+    void ComputeMatrix() override {
+        ModelParseReader::ComputeMatrix();
+        oracle_actions_.clear();
+        for (int i = 0, batch_index = 0; i < max_batch_size(); ++i) {
+            const ParserState *state = this->state(i);
+            if (state == nullptr) continue;
+            transition_system().GetDynamicOracleActions(*state, &optimal_actions_);
+            int best_action = optimal_actions_[0];
+            for (int action : optimal_actions_) {
+                if (scores_matrix_(batch_index, action) >
+                    scores_matrix_(batch_index, best_action)) {
+                    best_action = action;
+                }
+            }
+            oracle_actions_.push_back(best_action);
+            ++batch_index;
+        }
+    }
+
+private:
+    // Follows the model or the oracle on each state of the batch.
+    void PerformActions() override {
+        std::uniform_real_distribution<double> uniform(0, 1);
+        for (int i = 0, batch_index = 0; i < max_batch_size(); ++i) {
+            ParserState *state = this->state(i);
+            if (state == nullptr) continue;
+            const int action = uniform(random_) < exploration_probability_
+                               ? BestAllowedAction(batch_index, *state)
+                               : oracle_actions_[batch_index];
+            transition_system().PerformAction(action, state);
+            ++batch_index;
+        }
+    }
+
+    void AddAdditionalOutputs() override {
+    }
+
+    // Probability of following the model rather than the oracle.
+    double exploration_probability_;
 
-    map<string, string> conll_result_;
+    std::mt19937 random_;
+
+    // Scratch buffer for the optimal actions of a state.
+    vector<ParserAction> optimal_actions_;
+
+public:
+    // Label of each state of the scored batch, in batch order.
+    vector<int> oracle_actions_;
 };
 
 class WordEmbeddingInitializer {
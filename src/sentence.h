@@ -2,13 +2,22 @@
 #define SENTENCE_H
 
 #include "base.h"
+#include "utils/string_arena.h"
+#include "utils/string_piece.h"
 
+/*!
+ * \brief A token of a sentence. Its strings are stored in the arena of the
+ * sentence and are valid until the sentence is cleared.
+ */
 class Token {
 public:
     Token() : head_(-1) {}
-    void set_word(const std::string &word) { word_ = word; }
 
-    const string &word() const { return word_; }
+    explicit Token(StringArena *arena) : head_(-1), arena_(arena) {}
+
+    void set_word(StringPiece word) { word_ = arena_->Copy(word); }
+
+    StringPiece word() const { return word_; }
 
     void set_start(int32_t start) { start_ = start; }
 
@@ -23,48 +32,69 @@ public:
     int32_t head() const { return head_; }
     void clear_head() { head_ = -1; }
 
-    void set_tag(const std::string &tag) { tag_ = tag; }
+    void set_tag(StringPiece tag) { tag_ = arena_->Copy(tag); }
+
+    StringPiece tag() const { return tag_; }
+
+    void set_category(StringPiece category) { category_ = arena_->Copy(category); }
+
+    StringPiece category() const { return category_; }
 
-    const string &tag() const { return tag_; }
+    void set_label(StringPiece label) { label_ = arena_->Copy(label); }
 
-    void set_category(const std::string &category) { category_ = category; }
+    StringPiece label() const { return label_; }
 
-    const string &category() const { return category_; }
+    // Term map ids of the word, tag and label stored with the corpus, or -1.
+    // They are hints for TermFrequencyMap::LookupIndex, which checks them
+    // against the term, since the corpus may have been converted with other
+    // maps.
+    void set_word_id(int32_t word_id) { word_id_ = word_id; }
 
-    void set_label(const std::string &label) { label_ = label; }
+    int32_t word_id() const { return word_id_; }
 
-    const string &label() const { return label_; }
+    void set_tag_id(int32_t tag_id) { tag_id_ = tag_id; }
+
+    int32_t tag_id() const { return tag_id_; }
+
+    void set_label_id(int32_t label_id) { label_id_ = label_id; }
+
+    int32_t label_id() const { return label_id_; }
 
 private:
     // Token word form.
-    string word_;
+    StringPiece word_;
 
     // Start & End position of token in text.
-    int32_t start_;
-    int32_t end_;
+    int32_t start_ = 0;
+    int32_t end_ = 0;
 
     // head index.
     int32_t head_;
 
     // Part-of-Speech tag for token.
-    string tag_;
+    StringPiece tag_;
 
     // Coarse-grained word category for token.
-    string category_;
+    StringPiece category_;
 
     // Label for dependency relation between this token and its head.
-    string label_;
+    StringPiece label_;
 
-    enum BreakLevel {
-        NO_BREAK = 0,
-        SPACE_BREAK = 1,
-        LINE_BREAK = 2,
-        SENTENCE_BREAK = 3,
-    };
+    // Precomputed term map ids, or -1.
+    int32_t word_id_ = -1;
+    int32_t tag_id_ = -1;
+    int32_t label_id_ = -1;
 
-    BreakLevel break_level_;
+    // Arena of the sentence, which holds the strings. Not owned.
+    StringArena *arena_ = nullptr;
 };
 
+/*!
+ * \brief A sentence and its tokens. The tokens are stored contiguously and
+ * their strings in an arena owned by the sentence, so that filling a
+ * sentence takes a few allocations, and refilling a cleared one none once
+ * the token array and the arena are large enough.
+ */
 class Sentence {
 public:
     void set_docid(const std::string &docid) { docid_ = docid; }
@@ -75,34 +105,49 @@ public:
 
     const std::string &text() const { return text_; }
 
+    std::string *mutable_text() { return &text_; }
+
     // token
-    void set_token(const std::vector<Token *> &token) {
-        token_ = token;
-    }
-    Token &token(int index) const { return *token_[index]; }
-    Token *mutable_token(int index) { return token_[index]; }
+    const Token &token(int index) const { return token_[index]; }
+    Token *mutable_token(int index) { return &token_[index]; }
     int token_size() const { return token_.size(); }
+
+    // Adds a token. The pointer is valid until the next token is added.
     Token *add_token() {
-        Token *token = new Token();
-        token_.push_back(token);
-        return token;
+        token_.emplace_back(arena_.get());
+        return &token_.back();
     }
 
-public:
-    Sentence() {}
-
-    ~Sentence() {
-        for (size_t i = 0; i != token_size(); ++i) {
-            delete token_[i];
-        }
+    // Removes the text and all tokens, keeping the memory for reuse.
+    void Clear() {
+        docid_.clear();
+        text_.clear();
         token_.clear();
+        arena_->Clear();
     }
 
+    void Swap(Sentence *other) {
+        docid_.swap(other->docid_);
+        text_.swap(other->text_);
+        token_.swap(other->token_);
+        // The tokens keep pointing to their arena.
+        arena_.swap(other->arena_);
+    }
+
+public:
+    Sentence() : arena_(new StringArena()) {}
+
+    Sentence(const Sentence &) = delete;
+
+    Sentence &operator=(const Sentence &) = delete;
 
 private:
     std::string docid_;
     std::string text_;
-    std::vector<Token *> token_;
+    std::vector<Token> token_;
+
+    // Strings of the tokens.
+    std::unique_ptr<StringArena> arena_;
 };
 
 
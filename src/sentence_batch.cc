@@ -2,13 +2,25 @@
 #include "io/text_reader.h"
 
 void SentenceBatch::Init(TaskContext *context) {
-    reader_.reset(new TextReader(*context->GetInput(input_name_)));
+    const int prefetch_size = context->Get("prefetch_sentences", 4 * batch_size_);
+    const int part_index = context->Get("part_index", 0);
+    const int num_parts = context->Get("num_parts", 1);
+    const int shuffle_buffer_size = context->Get("shuffle_buffer_size", 0);
+    const int shuffle_seed = context->Get("shuffle_seed", 0);
+    reader_.reset(new ShuffleReader(
+        new TextReader(*context->GetInput(input_name_), prefetch_size,
+                       part_index, num_parts),
+        shuffle_buffer_size, shuffle_seed));
     size_ = 0;
 }
 
 bool SentenceBatch::AdvanceSentence(int index) {
-    if (sentences_[index] == nullptr) ++size_;
-    sentences_[index].reset();
+    if (sentences_[index] == nullptr) {
+        ++size_;
+    } else {
+        // Hand the previous sentence back to the reader for reuse.
+        reader_->Release(sentences_[index].release());
+    }
     std::unique_ptr<Sentence> sentence(reader_->Read());
     if (sentence == nullptr) {
         --size_;
@@ -1,10 +1,15 @@
 #include "sentence.h"
+#include "io/shuffle_reader.h"
 #include "io/text_reader.h"
 #include "utils/task_context.h"
 
 /*!
  * \brief Helper class to manage generating batches of preprocessed ParserState objects
  * by reading in multiple sentences in parallel.
+ *
+ * The sentences are pooled by the reader: a sentence that is advanced past
+ * is cleared and refilled rather than freed, keeping its token array and
+ * string arena, so that steady-state reading does not allocate.
  */
 class SentenceBatch {
   public:
@@ -13,7 +18,13 @@ class SentenceBatch {
       input_name_(input_name),
       sentences_(batch_size) {}
 
-    // Initializes all resources and opens the corpus file.
+    // Initializes all resources and opens the corpus file. The corpus is
+    // read ahead in a background thread unless the "prefetch_sentences"
+    // parameter is 0. With the "part_index" and "num_parts" parameters, only
+    // that shard of the corpus is read, e.g. by one of several workers. With
+    // a "shuffle_buffer_size" above 1, the sentences of each epoch come in an
+    // order shuffled through a buffer of that many sentences, drawn from the
+    // "shuffle_seed" parameter.
     void Init(TaskContext *context);
 
     // Advances the index'th sentence in the batch to the next sentence. This will
@@ -39,7 +50,7 @@ class SentenceBatch {
     string input_name_;
 
     // Reader for the corpus.
-    std::unique_ptr<TextReader> reader_;
+    std::unique_ptr<ShuffleReader> reader_;
 
     // Batch: Sentence objects.
     std::vector<std::unique_ptr<Sentence>> sentences_;
@@ -0,0 +1,35 @@
+#include "mapped_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const string &filename) : filename_(filename) {
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOG(FATAL) << "Open file [ " << filename << " ] failed: " << strerror(errno);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        LOG(FATAL) << "Stat file [ " << filename << " ] failed: " << strerror(errno);
+    }
+    size_ = st.st_size;
+
+    // mmap() rejects empty mappings.
+    if (size_ > 0) {
+        void *data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            LOG(FATAL) << "Mapping file [ " << filename << " ] failed: "
+                       << strerror(errno);
+        }
+        data_ = static_cast<const char *>(data);
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (data_ != nullptr) munmap(const_cast<char *>(data_), size_);
+}
@@ -0,0 +1,39 @@
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <stddef.h>
+#include <string>
+
+#include "../base.h"
+
+/*!
+ * \brief A read-only memory mapping of a whole file. The mapping is shared,
+ * so processes that map the same file share its pages in the page cache.
+ */
+class MappedFile {
+public:
+    // Maps the file; fails fatally if it cannot be opened or mapped.
+    explicit MappedFile(const string &filename);
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile();
+
+    const char *data() const { return data_; }
+
+    size_t size() const { return size_; }
+
+    const string &filename() const { return filename_; }
+
+private:
+    string filename_;
+
+    // Start of the mapping, or null for an empty file.
+    const char *data_ = nullptr;
+
+    size_t size_ = 0;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef STRING_ARENA_H_
+#define STRING_ARENA_H_
+
+#include <string.h>
+
+#include <memory>
+#include <vector>
+
+#include "string_piece.h"
+
+/*!
+ * \brief Bump allocator for the strings of one object, e.g. the token fields
+ * of a sentence, which are all freed at once by Clear().
+ *
+ * Copies are never moved, so the pieces returned by Copy() stay valid until
+ * Clear(). Clear() keeps the memory: when the strings did not fit into one
+ * block, the blocks are replaced by a single block as large as all of them,
+ * so an arena that is cleared and refilled with similar strings stops
+ * allocating after the first few rounds.
+ */
+class StringArena {
+public:
+    StringArena() {}
+
+    StringArena(const StringArena &) = delete;
+
+    StringArena &operator=(const StringArena &) = delete;
+
+    // Copies bytes into the arena.
+    StringPiece Copy(StringPiece bytes) {
+        if (bytes.empty()) return StringPiece();
+        char *data = Allocate(bytes.size());
+        memcpy(data, bytes.data(), bytes.size());
+        return StringPiece(data, bytes.size());
+    }
+
+    // Frees all copies.
+    void Clear() {
+        if (blocks_.size() > 1) {
+            size_t capacity = 0;
+            for (const Block &block : blocks_) capacity += block.capacity;
+            blocks_.clear();
+            AddBlock(capacity);
+        }
+        used_ = 0;
+    }
+
+private:
+    // Size of the first block.
+    static const size_t kMinBlockSize = 1 << 10;
+
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t capacity;
+    };
+
+    char *Allocate(size_t size) {
+        if (blocks_.empty() || blocks_.back().capacity - used_ < size) {
+            const size_t capacity = blocks_.empty() ? kMinBlockSize
+                                                    : 2 * blocks_.back().capacity;
+            AddBlock(capacity < size ? size : capacity);
+        }
+        char *data = blocks_.back().data.get() + used_;
+        used_ += size;
+        return data;
+    }
+
+    void AddBlock(size_t capacity) {
+        blocks_.push_back(Block{std::unique_ptr<char[]>(new char[capacity]), capacity});
+        used_ = 0;
+    }
+
+    // Blocks in the order of allocation; copies are made in the last one.
+    std::vector<Block> blocks_;
+
+    // Bytes used of the last block.
+    size_t used_ = 0;
+};
+
+#endif
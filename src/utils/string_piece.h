@@ -0,0 +1,75 @@
+#ifndef STRING_PIECE_H_
+#define STRING_PIECE_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <ostream>
+#include <string>
+
+/*!
+ * \brief A non-owning reference to a byte string, used for lookups that
+ * should not copy their key into a std::string (the tree is C++11, so
+ * std::string_view is not available). The referenced bytes must outlive the
+ * piece.
+ */
+class StringPiece {
+public:
+    StringPiece() : data_(nullptr), size_(0) {}
+
+    StringPiece(const char *data, size_t size) : data_(data), size_(size) {}
+
+    StringPiece(const char *str) : data_(str), size_(strlen(str)) {}  // NOLINT
+
+    StringPiece(const std::string &str)  // NOLINT
+        : data_(str.data()), size_(str.size()) {}
+
+    const char *data() const { return data_; }
+
+    size_t size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    char operator[](size_t i) const { return data_[i]; }
+
+    std::string ToString() const { return std::string(data_, size_); }
+
+    bool operator==(const StringPiece &other) const {
+        return size_ == other.size_ &&
+               (size_ == 0 || memcmp(data_, other.data_, size_) == 0);
+    }
+
+    bool operator!=(const StringPiece &other) const { return !(*this == other); }
+
+    // Lexicographic byte order, the same as std::string.
+    bool operator<(const StringPiece &other) const {
+        const size_t size = size_ < other.size_ ? size_ : other.size_;
+        const int result = size == 0 ? 0 : memcmp(data_, other.data_, size);
+        return result < 0 || (result == 0 && size_ < other.size_);
+    }
+
+private:
+    const char *data_;
+
+    size_t size_;
+};
+
+inline std::ostream &operator<<(std::ostream &os, const StringPiece &piece) {
+    return os.write(piece.data(), piece.size());
+}
+
+// FNV-1a hash of a byte string, used by the open-addressing tables of the
+// lexicon. Binary term maps store these hashes, so it must not change.
+inline uint32_t HashBytes(const char *data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+inline uint32_t HashBytes(const StringPiece &piece) {
+    return HashBytes(piece.data(), piece.size());
+}
+
+#endif
@@ -1,5 +1,7 @@
 #include "task_context.h"
 
+#include <glob.h>
+
 
 TaskInput *TaskContext::GetInput(const string &name) {
     // Return existing input if it exists.
@@ -96,6 +98,23 @@ string TaskContext::InputFile(const TaskInput &input) {
     return input.part(0).file_pattern();
 }
 
+vector<string> TaskContext::InputFiles(const TaskInput &input) {
+    vector<string> files;
+    for (int i = 0; i < input.part_size(); ++i) {
+        const string &pattern = input.part(i).file_pattern();
+        glob_t matches;
+        if (glob(pattern.c_str(), GLOB_NOCHECK, nullptr, &matches) == 0) {
+            for (size_t j = 0; j < matches.gl_pathc; ++j) {
+                files.push_back(matches.gl_pathv[j]);
+            }
+        } else {
+            files.push_back(pattern);
+        }
+        globfree(&matches);
+    }
+    return files;
+}
+
 bool TaskContext::Supports(const TaskInput &input, const string &file_format,
                            const string &record_format) {
     return false;
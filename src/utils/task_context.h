@@ -34,6 +34,11 @@ public:
   // Returns input file name for a single-file task input.
   static string InputFile(const TaskInput &input);
 
+  // Returns the files of all parts of a task input. File patterns are
+  // expanded as shell globs, with the matches of each in sorted order; a
+  // pattern without matches is returned as is.
+  static vector<string> InputFiles(const TaskInput &input);
+
   // Returns true if task input supports the file and record format.
   static bool Supports(const TaskInput &input, const string &file_format,
                        const string &record_format);
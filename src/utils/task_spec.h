@@ -24,7 +24,7 @@ public:
     const string &record_format() const {
         return record_format_;
     }
-    void set_record_format(const string &format) { file_format_ = format; }
+    void set_record_format(const string &format) { record_format_ = format; }
 
     bool multi_file_;
 
@@ -48,6 +48,8 @@ public:
         return part;
     }
 
+    int part_size() const { return part_.size(); }
+
     const Part &part(int index) const {
         return *part_[index];
     }